@@ -22,6 +22,8 @@
 */
 
 #include <string>
+#include <utility>
+#include <vector>
 #include <algorithm>
 #include <chrono>
 #include <iostream>
@@ -37,34 +39,40 @@ constexpr operator""_us(unsigned long long x)
 int main()
 {
 
-  using pbsf::crc32c_sse;
+  using pbsf::crc32c;
   using pbsf::crc32c_generic;
 
   std::chrono::high_resolution_clock clock;
 
-  for (int i_run=0; i_run<16; ++i_run) {
-
-    std::string input((5<<20) + 15, 0);
-    {
-      char _ = 0;
-      for (char& x : input)
-        x = ++_;
-    }
-
-    if (i_run&1) {
-      auto start = clock.now();
-      auto crc = crc32c_sse(input.data(), input.size());
-      auto dur = clock.now() - start;
-      std::cout << std::hex << crc << std::dec
-                << " in " << (dur/1_us) << "us by sse, "
-                << (double(input.size()) / double(dur/1_us))
-                << "MB/s\n";
-    } else {
+  std::vector<std::pair<const char*, decltype(&crc32c_generic)>> kernels {
+    { "sw", crc32c_generic },
+  };
+#ifdef PBSF_CRC32C_X86
+  if (pbsf::crc32c_sse_supported())
+    kernels.push_back({ "sse", pbsf::crc32c_sse });
+  if (pbsf::crc32c_pclmul_supported())
+    kernels.push_back({ "pclmul", pbsf::crc32c_pclmul });
+#endif // PBSF_CRC32C_X86
+  kernels.push_back({ "crc32c", static_cast<decltype(&crc32c_generic)>(crc32c) });
+  kernels.push_back({ "crc32c_parallel", [](const char* str, size_t count) {
+        return pbsf::crc32c_parallel(str, count);
+      } });
+
+  std::string input((5<<20) + 15, 0);
+  {
+    char _ = 0;
+    for (char& x : input)
+      x = ++_;
+  }
+
+  for (int i_run=0; i_run<8; ++i_run) {
+
+    for (auto& kernel : kernels) {
       auto start = clock.now();
-      auto crc = crc32c_generic(input.data(), input.size());
+      auto crc = kernel.second(input.data(), input.size());
       auto dur = clock.now() - start;
       std::cout << std::hex << crc << std::dec
-                << " in " << (dur/1_us) << "us by sw, "
+                << " in " << (dur/1_us) << "us by " << kernel.first << ", "
                 << (double(input.size()) / double(dur/1_us))
                 << "MB/s\n";
     }
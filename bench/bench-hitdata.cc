@@ -35,6 +35,7 @@
 #define BSIC_RAND_SIZE_MAX 0
 
 #include <bs3/pbss/pbss.hh>
+#include <bs3/pbss/view.hh>
 
 #include "hitdata.hh"
 #include "hitdata-gen.hh"
@@ -125,6 +126,17 @@ int main()
         ;
     }
 
+    {
+      auto time = time_us(NSAMPLES, [&]() {
+        return pbss::serialize_to_buffer_parallel(hitdata);
+      });
+      cout << "parallel serialize in "
+           << time << " us, "
+           << "real " << ((double)size / MB) / (time / 1e6) << " MiB/s, "
+           << "effective " << ((double)valid_size(nhits) / MB) / (time / 1e6) << "MiB/s\n"
+        ;
+    }
+
     {
       auto time = time_us(NSAMPLES, [&]() {
         return pbss::parse_from_buffer<HitData>(out);
@@ -136,6 +148,56 @@ int main()
         ;
     }
 
+    {
+      auto time = time_us(NSAMPLES, [&]() {
+        return pbss::parse_from_buffer_validated<HitData>(out);
+      });
+      cout << "validated parsed in "
+           << time << " us, "
+           << "real " << ((double)size / MB) / (time / 1e6) << " MiB/s, "
+           << "effective " << ((double)valid_size(nhits) / MB) / (time / 1e6) << "MiB/s\n"
+        ;
+    }
+
+    {
+      auto time = time_us(NSAMPLES, [&]() {
+        return pbss::parse_from_buffer<HitData>(
+          out, pbss::projection<&SingleHit::startTime, &SingleHit::area>());
+      });
+      cout << "projected parsed in "
+           << time << " us, "
+           << "real " << ((double)size / MB) / (time / 1e6) << " MiB/s, "
+           << "effective " << ((double)valid_size(nhits) / MB) / (time / 1e6) << "MiB/s\n"
+        ;
+    }
+
+    {
+      auto time = time_us(NSAMPLES, [&]() {
+        return pbss::parse_from_buffer_parallel<HitData>(out);
+      });
+      cout << "parallel parsed in "
+           << time << " us, "
+           << "real " << ((double)size / MB) / (time / 1e6) << " MiB/s, "
+           << "effective " << ((double)valid_size(nhits) / MB) / (time / 1e6) << "MiB/s\n"
+        ;
+    }
+
+    {
+      // selective read of a few fields in each PmtHit
+      auto time = time_us(NSAMPLES, [&]() {
+        auto view = pbss::make_view<HitData>(out);
+        uint64_t sum = view.get<&HitData::runNumber>() + view.get<&HitData::eventNumber>();
+        for (auto pmthit : view.at<&HitData::pmtHits>())
+          sum += pmthit.get<&PmtHit::pmtId>() + pmthit.at<&PmtHit::hits>().size();
+        return sum;
+      });
+      cout << "viewed in "
+           << time << " us, "
+           << "real " << ((double)size / MB) / (time / 1e6) << " MiB/s, "
+           << "effective " << ((double)valid_size(nhits) / MB) / (time / 1e6) << "MiB/s\n"
+        ;
+    }
+
     {
       auto time = time_us(NSAMPLES, [&]() {
         return pbss::parse_from_buffer<HitData_tailadd>(out);
@@ -0,0 +1,344 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include <bs3/pbss/pbss.hh>
+
+// Parse throughput of tagged structs when the optimistic in-order parse
+// misses, e.g. reordered records.  Build with
+// -DPBSS_STRUCT_DISPATCH_TABLE_THRESHOLD=255 to compare against linear
+// matching.
+
+std::chrono::duration<unsigned long long, std::micro>
+constexpr operator""_us(unsigned long long x)
+{
+  return std::chrono::duration<unsigned long long, std::micro>{x};
+}
+
+// as wide as a slow control record
+struct wide {
+  uint32_t ch01;
+  int16_t ch02;
+  double ch03;
+  uint32_t ch04;
+  int16_t ch05;
+  double ch06;
+  uint32_t ch07;
+  int16_t ch08;
+  double ch09;
+  uint32_t ch10;
+  int16_t ch11;
+  double ch12;
+  uint32_t ch13;
+  int16_t ch14;
+  double ch15;
+  uint32_t ch16;
+  int16_t ch17;
+  double ch18;
+  uint32_t ch19;
+  int16_t ch20;
+  double ch21;
+  uint32_t ch22;
+  int16_t ch23;
+  double ch24;
+  uint32_t ch25;
+  int16_t ch26;
+  double ch27;
+  uint32_t ch28;
+  int16_t ch29;
+  double ch30;
+  uint32_t ch31;
+  int16_t ch32;
+  double ch33;
+  uint32_t ch34;
+  int16_t ch35;
+  double ch36;
+  uint32_t ch37;
+  int16_t ch38;
+  double ch39;
+  uint32_t ch40;
+  int16_t ch41;
+  double ch42;
+  uint32_t ch43;
+  int16_t ch44;
+  double ch45;
+  uint32_t ch46;
+  int16_t ch47;
+  double ch48;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &wide::ch01),
+    PBSS_TAG_MEMBER(2, &wide::ch02),
+    PBSS_TAG_MEMBER(3, &wide::ch03),
+    PBSS_TAG_MEMBER(4, &wide::ch04),
+    PBSS_TAG_MEMBER(5, &wide::ch05),
+    PBSS_TAG_MEMBER(6, &wide::ch06),
+    PBSS_TAG_MEMBER(7, &wide::ch07),
+    PBSS_TAG_MEMBER(8, &wide::ch08),
+    PBSS_TAG_MEMBER(9, &wide::ch09),
+    PBSS_TAG_MEMBER(10, &wide::ch10),
+    PBSS_TAG_MEMBER(11, &wide::ch11),
+    PBSS_TAG_MEMBER(12, &wide::ch12),
+    PBSS_TAG_MEMBER(13, &wide::ch13),
+    PBSS_TAG_MEMBER(14, &wide::ch14),
+    PBSS_TAG_MEMBER(15, &wide::ch15),
+    PBSS_TAG_MEMBER(16, &wide::ch16),
+    PBSS_TAG_MEMBER(17, &wide::ch17),
+    PBSS_TAG_MEMBER(18, &wide::ch18),
+    PBSS_TAG_MEMBER(19, &wide::ch19),
+    PBSS_TAG_MEMBER(20, &wide::ch20),
+    PBSS_TAG_MEMBER(21, &wide::ch21),
+    PBSS_TAG_MEMBER(22, &wide::ch22),
+    PBSS_TAG_MEMBER(23, &wide::ch23),
+    PBSS_TAG_MEMBER(24, &wide::ch24),
+    PBSS_TAG_MEMBER(25, &wide::ch25),
+    PBSS_TAG_MEMBER(26, &wide::ch26),
+    PBSS_TAG_MEMBER(27, &wide::ch27),
+    PBSS_TAG_MEMBER(28, &wide::ch28),
+    PBSS_TAG_MEMBER(29, &wide::ch29),
+    PBSS_TAG_MEMBER(30, &wide::ch30),
+    PBSS_TAG_MEMBER(31, &wide::ch31),
+    PBSS_TAG_MEMBER(32, &wide::ch32),
+    PBSS_TAG_MEMBER(33, &wide::ch33),
+    PBSS_TAG_MEMBER(34, &wide::ch34),
+    PBSS_TAG_MEMBER(35, &wide::ch35),
+    PBSS_TAG_MEMBER(36, &wide::ch36),
+    PBSS_TAG_MEMBER(37, &wide::ch37),
+    PBSS_TAG_MEMBER(38, &wide::ch38),
+    PBSS_TAG_MEMBER(39, &wide::ch39),
+    PBSS_TAG_MEMBER(40, &wide::ch40),
+    PBSS_TAG_MEMBER(41, &wide::ch41),
+    PBSS_TAG_MEMBER(42, &wide::ch42),
+    PBSS_TAG_MEMBER(43, &wide::ch43),
+    PBSS_TAG_MEMBER(44, &wide::ch44),
+    PBSS_TAG_MEMBER(45, &wide::ch45),
+    PBSS_TAG_MEMBER(46, &wide::ch46),
+    PBSS_TAG_MEMBER(47, &wide::ch47),
+    PBSS_TAG_MEMBER(48, &wide::ch48));
+};
+
+struct wide_reversed {
+  uint32_t ch01;
+  int16_t ch02;
+  double ch03;
+  uint32_t ch04;
+  int16_t ch05;
+  double ch06;
+  uint32_t ch07;
+  int16_t ch08;
+  double ch09;
+  uint32_t ch10;
+  int16_t ch11;
+  double ch12;
+  uint32_t ch13;
+  int16_t ch14;
+  double ch15;
+  uint32_t ch16;
+  int16_t ch17;
+  double ch18;
+  uint32_t ch19;
+  int16_t ch20;
+  double ch21;
+  uint32_t ch22;
+  int16_t ch23;
+  double ch24;
+  uint32_t ch25;
+  int16_t ch26;
+  double ch27;
+  uint32_t ch28;
+  int16_t ch29;
+  double ch30;
+  uint32_t ch31;
+  int16_t ch32;
+  double ch33;
+  uint32_t ch34;
+  int16_t ch35;
+  double ch36;
+  uint32_t ch37;
+  int16_t ch38;
+  double ch39;
+  uint32_t ch40;
+  int16_t ch41;
+  double ch42;
+  uint32_t ch43;
+  int16_t ch44;
+  double ch45;
+  uint32_t ch46;
+  int16_t ch47;
+  double ch48;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(48, &wide_reversed::ch48),
+    PBSS_TAG_MEMBER(47, &wide_reversed::ch47),
+    PBSS_TAG_MEMBER(46, &wide_reversed::ch46),
+    PBSS_TAG_MEMBER(45, &wide_reversed::ch45),
+    PBSS_TAG_MEMBER(44, &wide_reversed::ch44),
+    PBSS_TAG_MEMBER(43, &wide_reversed::ch43),
+    PBSS_TAG_MEMBER(42, &wide_reversed::ch42),
+    PBSS_TAG_MEMBER(41, &wide_reversed::ch41),
+    PBSS_TAG_MEMBER(40, &wide_reversed::ch40),
+    PBSS_TAG_MEMBER(39, &wide_reversed::ch39),
+    PBSS_TAG_MEMBER(38, &wide_reversed::ch38),
+    PBSS_TAG_MEMBER(37, &wide_reversed::ch37),
+    PBSS_TAG_MEMBER(36, &wide_reversed::ch36),
+    PBSS_TAG_MEMBER(35, &wide_reversed::ch35),
+    PBSS_TAG_MEMBER(34, &wide_reversed::ch34),
+    PBSS_TAG_MEMBER(33, &wide_reversed::ch33),
+    PBSS_TAG_MEMBER(32, &wide_reversed::ch32),
+    PBSS_TAG_MEMBER(31, &wide_reversed::ch31),
+    PBSS_TAG_MEMBER(30, &wide_reversed::ch30),
+    PBSS_TAG_MEMBER(29, &wide_reversed::ch29),
+    PBSS_TAG_MEMBER(28, &wide_reversed::ch28),
+    PBSS_TAG_MEMBER(27, &wide_reversed::ch27),
+    PBSS_TAG_MEMBER(26, &wide_reversed::ch26),
+    PBSS_TAG_MEMBER(25, &wide_reversed::ch25),
+    PBSS_TAG_MEMBER(24, &wide_reversed::ch24),
+    PBSS_TAG_MEMBER(23, &wide_reversed::ch23),
+    PBSS_TAG_MEMBER(22, &wide_reversed::ch22),
+    PBSS_TAG_MEMBER(21, &wide_reversed::ch21),
+    PBSS_TAG_MEMBER(20, &wide_reversed::ch20),
+    PBSS_TAG_MEMBER(19, &wide_reversed::ch19),
+    PBSS_TAG_MEMBER(18, &wide_reversed::ch18),
+    PBSS_TAG_MEMBER(17, &wide_reversed::ch17),
+    PBSS_TAG_MEMBER(16, &wide_reversed::ch16),
+    PBSS_TAG_MEMBER(15, &wide_reversed::ch15),
+    PBSS_TAG_MEMBER(14, &wide_reversed::ch14),
+    PBSS_TAG_MEMBER(13, &wide_reversed::ch13),
+    PBSS_TAG_MEMBER(12, &wide_reversed::ch12),
+    PBSS_TAG_MEMBER(11, &wide_reversed::ch11),
+    PBSS_TAG_MEMBER(10, &wide_reversed::ch10),
+    PBSS_TAG_MEMBER(9, &wide_reversed::ch09),
+    PBSS_TAG_MEMBER(8, &wide_reversed::ch08),
+    PBSS_TAG_MEMBER(7, &wide_reversed::ch07),
+    PBSS_TAG_MEMBER(6, &wide_reversed::ch06),
+    PBSS_TAG_MEMBER(5, &wide_reversed::ch05),
+    PBSS_TAG_MEMBER(4, &wide_reversed::ch04),
+    PBSS_TAG_MEMBER(3, &wide_reversed::ch03),
+    PBSS_TAG_MEMBER(2, &wide_reversed::ch02),
+    PBSS_TAG_MEMBER(1, &wide_reversed::ch01));
+};
+
+// around the dispatch table threshold
+struct narrow {
+  uint32_t ch01;
+  int16_t ch02;
+  double ch03;
+  uint32_t ch04;
+  int16_t ch05;
+  double ch06;
+  uint32_t ch07;
+  int16_t ch08;
+  double ch09;
+  uint32_t ch10;
+  int16_t ch11;
+  double ch12;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &narrow::ch01),
+    PBSS_TAG_MEMBER(2, &narrow::ch02),
+    PBSS_TAG_MEMBER(3, &narrow::ch03),
+    PBSS_TAG_MEMBER(4, &narrow::ch04),
+    PBSS_TAG_MEMBER(5, &narrow::ch05),
+    PBSS_TAG_MEMBER(6, &narrow::ch06),
+    PBSS_TAG_MEMBER(7, &narrow::ch07),
+    PBSS_TAG_MEMBER(8, &narrow::ch08),
+    PBSS_TAG_MEMBER(9, &narrow::ch09),
+    PBSS_TAG_MEMBER(10, &narrow::ch10),
+    PBSS_TAG_MEMBER(11, &narrow::ch11),
+    PBSS_TAG_MEMBER(12, &narrow::ch12));
+};
+
+struct narrow_reversed {
+  uint32_t ch01;
+  int16_t ch02;
+  double ch03;
+  uint32_t ch04;
+  int16_t ch05;
+  double ch06;
+  uint32_t ch07;
+  int16_t ch08;
+  double ch09;
+  uint32_t ch10;
+  int16_t ch11;
+  double ch12;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(12, &narrow_reversed::ch12),
+    PBSS_TAG_MEMBER(11, &narrow_reversed::ch11),
+    PBSS_TAG_MEMBER(10, &narrow_reversed::ch10),
+    PBSS_TAG_MEMBER(9, &narrow_reversed::ch09),
+    PBSS_TAG_MEMBER(8, &narrow_reversed::ch08),
+    PBSS_TAG_MEMBER(7, &narrow_reversed::ch07),
+    PBSS_TAG_MEMBER(6, &narrow_reversed::ch06),
+    PBSS_TAG_MEMBER(5, &narrow_reversed::ch05),
+    PBSS_TAG_MEMBER(4, &narrow_reversed::ch04),
+    PBSS_TAG_MEMBER(3, &narrow_reversed::ch03),
+    PBSS_TAG_MEMBER(2, &narrow_reversed::ch02),
+    PBSS_TAG_MEMBER(1, &narrow_reversed::ch01));
+};
+
+template <class T>
+std::vector<T> make_records(std::size_t n)
+{
+  std::vector<T> records(n);
+  char _ = 0;
+  for (auto& r : records)
+    for (char* p = reinterpret_cast<char*>(&r);
+         p != reinterpret_cast<char*>(&r+1); ++p)
+      *p = ++_;
+  return records;
+}
+
+template <class Parsed, class Written>
+void bench(const char* name, std::size_t n)
+{
+  std::chrono::high_resolution_clock clock;
+  auto buf = pbss::serialize_to_buffer(make_records<Written>(n));
+  auto best = clock.now() - clock.now();
+  best = best.max();
+  for (int i_run=0; i_run<8; ++i_run) {
+    auto start = clock.now();
+    auto records = pbss::parse_from_buffer<std::vector<Parsed>>(buf);
+    auto dur = clock.now() - start;
+    if (records.size() != n)
+      std::cerr << "wrong record count\n";
+    best = std::min(best, dur);
+  }
+  std::cout << name << ": " << (best/1_us) << "us, "
+            << (double(buf.size()) / double(best/1_us)) << "MB/s\n";
+}
+
+int main()
+{
+  std::cout << "dispatch table threshold "
+            << PBSS_STRUCT_DISPATCH_TABLE_THRESHOLD << "\n";
+  bench<wide, wide>("48 members in order", 1<<15);
+  bench<wide, wide_reversed>("48 members reversed", 1<<15);
+  bench<narrow, narrow>("12 members in order", 1<<17);
+  bench<narrow, narrow_reversed>("12 members reversed", 1<<17);
+  return 0;
+}
@@ -0,0 +1,118 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include <bs3/pbss/pbss.hh>
+
+// Bulk var uint coding against the byte at a time loops, on sequences of
+// values of a few length distributions.
+
+std::chrono::duration<unsigned long long, std::micro>
+constexpr operator""_us(unsigned long long x)
+{
+  return std::chrono::duration<unsigned long long, std::micro>{x};
+}
+
+using values = std::vector<pbss::var_uint<uint64_t>>;
+
+template <class Function>
+std::chrono::high_resolution_clock::duration best_of(Function fn)
+{
+  std::chrono::high_resolution_clock clock;
+  auto best = std::chrono::high_resolution_clock::duration::max();
+  for (int i_run=0; i_run<16; ++i_run) {
+    auto start = clock.now();
+    fn();
+    best = std::min(best, clock.now() - start);
+  }
+  return best;
+}
+
+void report(const char* name, std::size_t size,
+            std::chrono::high_resolution_clock::duration dur)
+{
+  std::cout << "  " << name << " in " << (dur/1_us) << "us, "
+            << (double(size) / double(dur/1_us)) << "MB/s\n";
+}
+
+void bench(const char* name, const values& input)
+{
+  using namespace pbss::vuint_impl;
+  std::cout << name << ":\n";
+  auto buf = pbss::serialize_to_buffer(input);
+  auto bytes = reinterpret_cast<const char*>(&*buf.begin());
+  std::string out(buf.size(), 0);
+
+  report("encode bytewise", buf.size(), best_of([&] {
+        pbss::char_range_writer writer(&out[0]);
+        write_var_uint(writer, input.size());
+        for (auto v : input)
+          write_var_uint(writer, v.v);
+      }));
+  report("encode bulk", buf.size(), best_of([&] {
+        pbss::char_range_writer writer(&out[0]);
+        serialize(writer, input);
+      }));
+
+  values parsed(input.size());
+  report("decode bytewise", buf.size(), best_of([&] {
+        pbss::char_range_reader reader(bytes, bytes+buf.size());
+        read_var_uint_bytewise<std::size_t>(reader);
+        for (auto& v : parsed)
+          v.v = read_var_uint_bytewise<uint64_t>(reader);
+      }));
+  report("decode bulk", buf.size(), best_of([&] {
+        pbss::char_range_reader reader(bytes, bytes+buf.size());
+        read_var_uint<std::size_t>(reader);
+        read_var_uints(reader, parsed.data(), parsed.size(), 0);
+      }));
+  if (parsed != input)
+    std::cerr << "decoded values differ\n";
+}
+
+int main()
+{
+  constexpr std::size_t n = 1<<20;
+  uint64_t x = 1;
+  auto next = [&] {
+    return x = x * 6364136223846793005ull + 1442695040888963407ull;
+  };
+
+  values small(n), mixed(n), wide(n);
+  for (auto& v : small)
+    v.v = next() >> 57;
+  // 1 to 4 bytes, lengths shuffled
+  for (auto& v : mixed)
+    v.v = next() >> (36 + next() % 28);
+  for (auto& v : wide)
+    v.v = next() >> 8;
+
+  bench("1 byte", small);
+  bench("1-4 bytes", mixed);
+  bench("8 bytes", wide);
+  return 0;
+}
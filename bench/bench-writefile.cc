@@ -47,11 +47,13 @@
 
 PBSF_DECLARE_REALM(
   BenchRealm, 42,
-  PBSF_REGISTER_TYPE(1, HitData));
+  PBSF_REGISTER_TYPE(1, HitData),
+  PBSF_REGISTER_TYPE(2, int));
 
 #define NHITS 200
 #define NPMTS 200
 #define NSAMPLES 300
+#define NSMALL 2000000
 
 int main(int argc, char** argv)
 {
@@ -72,6 +74,60 @@ int main(int argc, char** argv)
 
   std::string filename(argc>1 ? argv[1] : "/dev/null");
 
+  // many small blocks, where the stream itself shows; the same through
+  // std::fstream for comparison
+
+  {
+    auto start = clock.now();
+
+    auto out = open_sequential_output_file(filename, BenchRealm());
+    std::fill_n(out.write_iterator(), NSMALL, 42);
+
+    auto dur = clock.now() - start;
+    auto time = duration_cast<milliseconds>(dur).count();
+    cout << NSMALL << " small blocks written in " << time << " ms\n";
+  }
+
+  {
+    auto in = open_sequential_input_file(filename, BenchRealm());
+
+    auto start = clock.now();
+
+    for (int x : in.read_one_type<int>())
+      (void)x;
+
+    auto dur = clock.now() - start;
+    auto time = duration_cast<milliseconds>(dur).count();
+    cout << "read back in " << time << " ms\n";
+  }
+
+  {
+    auto start = clock.now();
+
+    std::ofstream s(filename, std::ios_base::binary);
+    auto out = open_sequential_output_file(s, BenchRealm());
+    std::fill_n(out.write_iterator(), NSMALL, 42);
+    s.close();
+
+    auto dur = clock.now() - start;
+    auto time = duration_cast<milliseconds>(dur).count();
+    cout << NSMALL << " small blocks written through std::fstream in " << time << " ms\n";
+  }
+
+  {
+    std::ifstream s(filename, std::ios_base::binary);
+    auto in = open_sequential_input_file(s, BenchRealm());
+
+    auto start = clock.now();
+
+    for (int x : in.read_one_type<int>())
+      (void)x;
+
+    auto dur = clock.now() - start;
+    auto time = duration_cast<milliseconds>(dur).count();
+    cout << "read back through std::fstream in " << time << " ms\n";
+  }
+
   {
     auto start = clock.now();
 
@@ -4,7 +4,10 @@
 
 template pbss::buffer pbss::serialize_to_buffer(const HitData&);
 template pbss::buffer pbss::serialize_to_buffer(const HitData_tuple&);
+template pbss::buffer pbss::serialize_to_buffer_parallel(const HitData&, unsigned);
 template HitData pbss::parse_from_buffer<HitData>(const pbss::buffer&);
 template HitData_tuple pbss::parse_from_buffer<HitData_tuple>(const pbss::buffer&);
 template HitData_tailadd pbss::parse_from_buffer<HitData_tailadd>(const pbss::buffer&);
 template HitData_mismatch pbss::parse_from_buffer<HitData_mismatch>(const pbss::buffer&);
+template HitData pbss::parse_from_buffer_parallel<HitData>(const pbss::buffer&, unsigned);
+template HitData pbss::parse_from_buffer_validated<HitData>(const pbss::buffer&);
@@ -0,0 +1,93 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSF_BLOCK_TABLE_HH
+#define BS3_PBSF_BLOCK_TABLE_HH
+
+// A sparse table of the blocks in a sequential file: for each content type,
+// how many blocks there are and where every PBSF_BLOCK_TABLE_GROUP-th one
+// starts.  Writers may store it in a footer (see footer.hh) so readers can
+// count and seek without parsing the whole file.
+
+#include <cstdint>
+#include <ios>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <bs3/pbss/pbss.hh>
+
+#include "defs.hh"
+
+#ifndef PBSF_BLOCK_TABLE_GROUP
+#  define PBSF_BLOCK_TABLE_GROUP 256
+#endif
+
+namespace pbsf {
+
+inline
+namespace abiv1 {
+
+struct type_blocks {
+  uint64_t count = 0;
+  // offsets of blocks 0, group, 2*group... of the type
+  std::vector<int64_t> samples;
+
+  PBSS_TUPLE_MEMBERS(
+    PBSS_TUPLE_MEMBER(&type_blocks::count),
+    PBSS_TUPLE_MEMBER(&type_blocks::samples));
+};
+
+struct block_table {
+  uint32_t group = PBSF_BLOCK_TABLE_GROUP;
+  // one past the last block
+  int64_t end = 0;
+  std::map<int16_t, type_blocks> types;
+  // whether read from a footer, rather than by scanning; not stored
+  bool from_footer = false;
+
+  // records a block of type at offset, after those already recorded
+  void add(int16_t type, std::streamoff offset);
+
+  // how many blocks of type there are
+  uint64_t count(int16_t type) const;
+
+  // how many blocks there are in all
+  uint64_t size() const;
+
+  // where to look for the nth block of type, counting from 0: the offset
+  // of an earlier block of that type, and how many blocks of the type to
+  // pass over from there; offset -1 if there are not that many
+  std::pair<std::streamoff, uint64_t> locate(int16_t type, uint64_t n) const;
+
+  PBSS_TUPLE_MEMBERS(
+    PBSS_TUPLE_MEMBER(&block_table::group),
+    PBSS_TUPLE_MEMBER(&block_table::end),
+    PBSS_TUPLE_MEMBER(&block_table::types));
+};
+
+} // inline namespace abiv1
+
+} // namespace pbsf
+
+#endif /* BS3_PBSF_BLOCK_TABLE_HH */
@@ -34,11 +34,37 @@ namespace pbsf {
 uint32_t crc32c(const char*, size_t);
 uint32_t crc32c_generic(const char*, size_t);
 
-#ifdef __SSE4_2__
+// continue a crc32c over more data: crc32c_extend(crc32c(a), b) ==
+// crc32c(a+b), and crc32c_extend(0, a) == crc32c(a); for computing the
+// checksum piecewise while the data is still in cache
+uint32_t crc32c_extend(uint32_t crc, const char*, size_t);
 
+// crc32c of the concatenation of a and b, from crc_a = crc32c(a), crc_b =
+// crc32c(b) and the length of b, in O(log len_b) time
+uint32_t crc32c_combine(uint32_t crc_a, uint32_t crc_b, size_t len_b);
+
+// crc32c computed by up to threads threads (0 for one per core) over
+// adjacent pieces, then combined; short inputs take fewer threads, down to
+// a single one
+uint32_t crc32c_parallel(const char*, size_t, unsigned threads = 0);
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#define PBSF_CRC32C_X86 1
+
+// Hardware kernels, built regardless of compiler flags; call them only
+// where supported.  crc32c picks the fastest one at run time.
+
+// one stream of crc32 instructions, needs SSE4.2
+bool crc32c_sse_supported();
 uint32_t crc32c_sse(const char*, size_t);
 
-#endif // __SSE4_2__
+// three interleaved streams merged with carry-less multiplies, needs SSE4.2
+// and PCLMULQDQ
+bool crc32c_pclmul_supported();
+uint32_t crc32c_pclmul(const char*, size_t);
+
+#endif // x86-64
 
 inline uint32_t crc32c(const std::string& str)
 {
@@ -50,6 +76,11 @@ inline uint32_t crc32c(const pbss::buffer& buf)
   return crc32c(reinterpret_cast<const char*>(&*buf.begin()), buf.size());
 }
 
+inline uint32_t crc32c_parallel(const pbss::buffer& buf, unsigned threads = 0)
+{
+  return crc32c_parallel(reinterpret_cast<const char*>(buf.data()), buf.size(), threads);
+}
+
 } // namespace pbsf
 
 #endif /* PBS_PBSF_CRC32_HH */
@@ -24,10 +24,17 @@
 #ifndef BS3_PBSF_DATA_BLOCK_HH
 #define BS3_PBSF_DATA_BLOCK_HH
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <variant>
+
 #include <bs3/pbss/pbss.hh>
 
 #include <bs3/utils/iter-util.hh>
 
+#include "block-table.hh"
 #include "crc-32.hh"
 #include "defs.hh"
 #include "realm.hh"
@@ -41,12 +48,16 @@ EncodedBlock encode_block(int16_t id, pbss::buffer&& raw,
 
 pbss::buffer decode_block(EncodedBlock&& block);
 
-template <class T, class Realm>
-void write_block(std::ostream& stream, Realm, const T& value)
+template <class T, class Realm, class Stream>
+void write_block(Stream& stream, Realm, const T& value)
 {
   constexpr auto tid = lookup_id<T>(Realm());
   using pbss::serialize;
   serialize(stream, encode_block(tid, pbss::serialize_to_buffer(value)));
+  // streams passing blocks on as messages, e.g. ring_writer, are told
+  // where each ends
+  if constexpr (requires { stream.end_block(); })
+    stream.end_block();
 }
 
 template <class Stream>
@@ -75,17 +86,172 @@ struct parse_from_block {
 
 } // inline namespace abiv1
 
+// A jump table over the types of a realm: an entry index for each content
+// type, found by indexing an array when the ids are close together and by
+// binary search otherwise, then one function pointer per entry.
+
+template <class... entries>
+struct dispatch_table;
+
+template <int16_t... ids, class... Ts>
+struct dispatch_table<type_entry<ids, Ts>...> {
+
+  static constexpr std::size_t size = sizeof...(ids);
+  static constexpr std::size_t npos = std::size_t(-1);
+
+private:
+
+  static constexpr int min_id = std::min({int(ids)...});
+  static constexpr int max_id = std::max({int(ids)...});
+  static constexpr std::size_t span = std::size_t(max_id - min_id + 1);
+  static constexpr bool dense = span <= 4*size + 64;
+
+  struct id_index {
+    int16_t id;
+    std::size_t index;
+  };
+
+  static constexpr auto make_sorted()
+  {
+    std::array<id_index, size> a {};
+    std::size_t i = 0;
+    ((a[i] = id_index{ids, i}, ++i), ...);
+    std::sort(a.begin(), a.end(), [](auto x, auto y) { return x.id < y.id; });
+    return a;
+  }
+
+  static constexpr auto make_dense()
+  {
+    std::array<std::size_t, dense ? span : 0> a {};
+    if constexpr (dense) {
+      for (auto& x : a)
+        x = npos;
+      std::size_t i = 0;
+      ((a[std::size_t(int(ids) - min_id)] = i++), ...);
+    }
+    return a;
+  }
+
+  static constexpr auto sorted = make_sorted();
+  static constexpr auto indices = make_dense();
+
+public:
+
+  static constexpr std::size_t index_of(int16_t id)
+  {
+    if constexpr (dense) {
+      if (id < min_id || id > max_id)
+        return npos;
+      return indices[std::size_t(int(id) - min_id)];
+    } else {
+      auto it = std::lower_bound(sorted.begin(), sorted.end(), id,
+                                 [](auto x, int16_t y) { return x.id < y; });
+      return it != sorted.end() && it->id == id ? it->index : npos;
+    }
+  }
+
+  template <class Variant, std::size_t... I>
+  static constexpr auto make_variant_parsers(std::index_sequence<I...>)
+  {
+    return std::array<Variant (*)(const pbss::buffer&), size> {
+      [](const pbss::buffer& buf) {
+        return Variant(std::in_place_index<I>, pbss::parse_from_buffer<Ts>(buf));
+      }...
+    };
+  }
+
+  template <class Visitor>
+  static constexpr auto make_visitors()
+  {
+    return std::array<void (*)(const pbss::buffer&, Visitor&), size> {
+      [](const pbss::buffer& buf, Visitor& vis) {
+        vis(pbss::parse_from_buffer<Ts>(buf));
+      }...
+    };
+  }
+
+};
+
+template <class... entries>
+dispatch_table<entries...> dispatch_table_of(abstract_realm<entries...>);
+
+template <class Realm>
+using realm_dispatch_table = decltype(dispatch_table_of(Realm()));
+
+template <int16_t... ids, class... Ts>
+std::variant<Ts...> variant_of(abstract_realm<type_entry<ids, Ts>...>);
+
+} // namespace iter_impl
+
+// std::variant of the types in a realm, in order of registration
+template <class Realm>
+using realm_variant = decltype(iter_impl::variant_of(Realm()));
+
+// whether a block holds a type of the realm
+template <class Realm>
+bool is_known_block(const EncodedBlock& block)
+{
+  using table = iter_impl::realm_dispatch_table<Realm>;
+  return table::index_of(block.contentType) != table::npos;
+}
+
+// decodes a block of a type in the realm into the variant; throws
+// type_mismatch_error for other types
+template <class Realm>
+realm_variant<Realm> decode_variant(EncodedBlock&& block)
+{
+  using table = iter_impl::realm_dispatch_table<Realm>;
+  static constexpr auto parsers = table::template make_variant_parsers<realm_variant<Realm>>(
+    std::make_index_sequence<table::size>());
+  auto i = table::index_of(block.contentType);
+  if (i == table::npos)
+    throw type_mismatch_error();
+  return parsers[i](decode_block(std::move(block)));
+}
+
+// decodes a block and passes the value to vis, which takes every type in
+// the realm; blocks of other types are left undecoded, and false returned
+template <class Realm, class Visitor>
+bool visit_block(EncodedBlock&& block, Visitor& vis)
+{
+  using table = iter_impl::realm_dispatch_table<Realm>;
+  static constexpr auto visitors = table::template make_visitors<Visitor>();
+  auto i = table::index_of(block.contentType);
+  if (i == table::npos)
+    return false;
+  visitors[i](decode_block(std::move(block)), vis);
+  return true;
+}
+
+namespace iter_impl {
+
+template <class Realm>
+struct check_known {
+  bool operator()(const EncodedBlock& block) const
+  {
+    return is_known_block<Realm>(block);
+  }
+};
+
+template <class Realm>
+struct parse_variant_from_block {
+  realm_variant<Realm> operator()(EncodedBlock& block) const
+  {
+    return decode_variant<Realm>(std::move(block));
+  }
+};
+
 } // namespace iter_impl
 
 inline
 namespace abiv1 {
 
-template <class Realm, class T>
+template <class Realm, class T, class Stream = std::istream>
 struct skipping_read_iterator
   : public pbsu::mapping_iterator<
       iter_impl::parse_from_block<T>,
       pbsu::filtering_iterator<
-        iter_impl::check_id<lookup_id<T>(Realm())>, block_read_iterator<std::istream>>,
+        iter_impl::check_id<lookup_id<T>(Realm())>, block_read_iterator<Stream>>,
       true
     > {
 
@@ -94,7 +260,7 @@ private:
   using base = pbsu::mapping_iterator<
     iter_impl::parse_from_block<T>,
     pbsu::filtering_iterator<
-      iter_impl::check_id<lookup_id<T>(Realm())>, block_read_iterator<std::istream>>,
+      iter_impl::check_id<lookup_id<T>(Realm())>, block_read_iterator<Stream>>,
     true
   >;
 
@@ -104,28 +270,63 @@ public:
     : base({}, { {}, {}, {} })
   {}
 
-  skipping_read_iterator(std::istream& s)
+  skipping_read_iterator(Stream& s)
     : base({}, { {}, s, {} })
   {}
 
 };
 
-template <class Realm>
+// reads every block of a type in the realm, as realm_variant<Realm>
+template <class Realm, class Stream = std::istream>
+struct heterogeneous_read_iterator
+  : public pbsu::mapping_iterator<
+      iter_impl::parse_variant_from_block<Realm>,
+      pbsu::filtering_iterator<
+        iter_impl::check_known<Realm>, block_read_iterator<Stream>>,
+      true
+    > {
+
+private:
+
+  using base = pbsu::mapping_iterator<
+    iter_impl::parse_variant_from_block<Realm>,
+    pbsu::filtering_iterator<
+      iter_impl::check_known<Realm>, block_read_iterator<Stream>>,
+    true
+  >;
+
+public:
+
+  heterogeneous_read_iterator()
+    : base({}, { {}, {}, {} })
+  {}
+
+  heterogeneous_read_iterator(Stream& s)
+    : base({}, { {}, s, {} })
+  {}
+
+};
+
+template <class Realm, class Stream = std::ostream>
 struct heterogeneous_write_iterator
-  : pbsu::output_iterator_mixin<heterogeneous_write_iterator<Realm> > {
+  : pbsu::output_iterator_mixin<heterogeneous_write_iterator<Realm, Stream> > {
 
 private:
-  std::ostream* stream_ptr;
+  Stream* stream_ptr;
+  block_table* table_ptr;
 
 public:
 
-  heterogeneous_write_iterator(std::ostream& s)
-    : stream_ptr(&s)
+  // blocks written are recorded in table, if given
+  heterogeneous_write_iterator(Stream& s, block_table* table = nullptr)
+    : stream_ptr(&s), table_ptr(table)
   {}
 
   template <class T>
   heterogeneous_write_iterator& operator=(const T& v)
   {
+    if (table_ptr)
+      table_ptr->add(lookup_id<T>(Realm()), stream_ptr->tellp());
     write_block(*stream_ptr, Realm(), v);
     return *this;
   }
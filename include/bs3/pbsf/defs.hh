@@ -118,6 +118,21 @@ struct EncodedBlock {
     PBSS_TUPLE_MEMBER(&EncodedBlock::content));
 };
 
+// The part of an EncodedBlock before its content, i.e. what to read to
+// find where the block ends without reading it.
+struct BlockHeader {
+  int16_t contentType = 1;
+  int16_t contentEncoding = 1;
+  uint32_t contentChecksum = 0;
+  pbss::var_uint<uint64_t> contentLength {0};
+
+  PBSS_TUPLE_MEMBERS(
+    PBSS_TUPLE_MEMBER(&BlockHeader::contentType),
+    PBSS_TUPLE_MEMBER(&BlockHeader::contentEncoding),
+    PBSS_TUPLE_MEMBER(&BlockHeader::contentChecksum),
+    PBSS_TUPLE_MEMBER(&BlockHeader::contentLength));
+};
+
 } // inline namespace abiv1
 
 }
@@ -31,15 +31,15 @@
 
 namespace pbsf {
 
-template <uint32_t id, class... entries>
-bool check_file(std::istream& stream, realm<id, entries...>)
+template <class Stream, uint32_t id, class... entries>
+bool check_file(Stream& stream, realm<id, entries...>)
 {
   using pbss::parse;
   return FileHeader{magic, id} == parse<FileHeader>(stream);
 }
 
-template <uint32_t id, class... entries>
-void write_header(std::ostream& stream, realm<id, entries...>)
+template <class Stream, uint32_t id, class... entries>
+void write_header(Stream& stream, realm<id, entries...>)
 {
   using pbss::serialize;
   serialize(stream, FileHeader{magic, id});
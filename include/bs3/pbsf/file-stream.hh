@@ -0,0 +1,227 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSF_FILE_STREAM_HH
+#define BS3_PBSF_FILE_STREAM_HH
+
+// A buffered stream on a raw file descriptor, with the members pbss uses
+// to parse and serialize (get, peek, read, ignore, lookahead, eof, put,
+// write) inline and non-virtual; the open_* functions use it instead of
+// std::fstream.  Reading and writing share one aligned buffer, refilled or
+// flushed by plain read(2) and write(2), and requests larger than the
+// buffer go to the file directly.  Errors from the system throw
+// std::system_error; running out of input sets eof() as an istream does.
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <ios>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include <bs3/utils/misc.hh>
+
+#ifndef PBSF_FILE_BUFFER_SIZE
+#  define PBSF_FILE_BUFFER_SIZE (std::size_t(1)<<20)
+#endif
+
+namespace pbsf {
+
+inline
+namespace abiv1 {
+
+enum class open_mode {
+  read,                         // read only, must exist
+  overwrite,                    // read and write, created or truncated
+  update,                       // read and write, created if missing
+};
+
+class file_stream {
+
+public:
+
+  typedef std::char_traits<char> traits_type;
+  typedef traits_type::int_type int_type;
+
+  explicit file_stream(const std::string& filename, open_mode mode = open_mode::read,
+                       std::size_t buffer_size = PBSF_FILE_BUFFER_SIZE);
+
+  file_stream(const file_stream&) = delete;
+  file_stream& operator=(const file_stream&) = delete;
+
+  // flushes, ignoring errors; call flush() first to see them
+  ~file_stream();
+
+  // input
+
+  file_stream& read(char* dest, std::streamsize count)
+  {
+    if (BS3_LIKELY(count <= rend - rcur)) {
+      std::memcpy(dest, rcur, pbsu::to_unsigned(count));
+      rcur += count;
+    } else read_slow(dest, count);
+    return *this;
+  }
+
+  int_type get()
+  {
+    if (BS3_LIKELY(rcur != rend))
+      return traits_type::to_int_type(*rcur++);
+    return get_slow();
+  }
+
+  int_type peek()
+  {
+    if (BS3_LIKELY(rcur != rend))
+      return traits_type::to_int_type(*rcur);
+    return peek_slow();
+  }
+
+  void ignore(std::streamsize count)
+  {
+    if (BS3_LIKELY(count <= rend - rcur))
+      rcur += count;
+    else ignore_slow(count);
+  }
+
+  // the next count chars in the buffer, reading more if needed; null if
+  // the file ends before, or count is larger than the buffer
+  const char* lookahead(std::streamsize count)
+  {
+    if (BS3_LIKELY(count <= rend - rcur))
+      return rcur;
+    return lookahead_slow(count);
+  }
+
+  // whether a read has run out of input; cleared by seeking
+  bool eof() const
+  {
+    return at_eof;
+  }
+
+  void clear()
+  {
+    at_eof = false;
+  }
+
+  // output
+
+  file_stream& put(char ch)
+  {
+    if (BS3_LIKELY(wcur != wend))
+      *wcur++ = ch;
+    else write_slow(&ch, 1);
+    return *this;
+  }
+
+  file_stream& write(const char* src, std::streamsize count)
+  {
+    if (BS3_LIKELY(count <= wend - wcur)) {
+      std::memcpy(wcur, src, pbsu::to_unsigned(count));
+      wcur += count;
+    } else write_slow(src, count);
+    return *this;
+  }
+
+  file_stream& flush();
+
+  // positioning; there is one position for both reading and writing, as
+  // in std::fstream
+
+  std::streamoff tellg() const
+  {
+    return base + (writing ? wcur - buf.get() : rcur - buf.get());
+  }
+
+  std::streamoff tellp() const
+  {
+    return tellg();
+  }
+
+  file_stream& seekg(std::streamoff off, std::ios_base::seekdir dir = std::ios_base::beg);
+
+  file_stream& seekp(std::streamoff off, std::ios_base::seekdir dir = std::ios_base::beg)
+  {
+    return seekg(off, dir);
+  }
+
+  // cuts the file down to size; the position is left where it was
+  void truncate(std::streamoff size);
+
+  // reads stop at end, and seeking relative to the end is from there, as
+  // if the file ended there
+  void limit(std::streamoff end);
+
+  int fd() const
+  {
+    return file;
+  }
+
+private:
+
+  struct free_deleter {
+    void operator()(char* p) const
+    {
+      std::free(p);
+    }
+  };
+
+  int file;
+  std::size_t capacity;
+  std::unique_ptr<char[], free_deleter> buf;
+  // file offset of buf[0]
+  std::streamoff base = 0;
+  // unread input in [rcur, rend); empty while writing
+  const char* rcur;
+  const char* rend;
+  // pending output in [buf, wcur), room up to wend; empty while reading
+  char* wcur;
+  char* wend;
+  bool writing = false;
+  bool at_eof = false;
+  // set by limit()
+  std::streamoff stop = std::numeric_limits<std::streamoff>::max();
+
+  void read_slow(char* dest, std::streamsize count);
+  int_type get_slow();
+  int_type peek_slow();
+  void ignore_slow(std::streamsize count);
+  const char* lookahead_slow(std::streamsize count);
+  void write_slow(const char* src, std::streamsize count);
+
+  // make at least count chars available unless at end of file; returns
+  // how many are
+  std::streamsize fill(std::streamsize count);
+  // how much of count chars from file offset at are before stop
+  std::size_t before_stop(std::streamoff at, std::size_t count) const;
+  void start_reading();
+  void start_writing();
+
+};
+
+} // inline namespace abiv1
+
+} // namespace pbsf
+
+#endif /* BS3_PBSF_FILE_STREAM_HH */
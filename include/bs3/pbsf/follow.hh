@@ -0,0 +1,113 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSF_FOLLOW_HH
+#define BS3_PBSF_FOLLOW_HH
+
+// Reading a sequential file while another process is still appending to
+// it, as tail -f does.  The end of the file means no block yet rather than
+// the end of the data: the reader waits for the file to grow, woken by
+// inotify where available and by polling otherwise, and returns a block
+// only once all of it has been written.
+
+#include <chrono>
+#include <cstdint>
+#include <ios>
+#include <string>
+#include <vector>
+
+#include "defs.hh"
+#include "realm.hh"
+
+// longest wait between looks at the file size; the only wait without
+// inotify, and a safeguard with it, e.g. on network file systems where
+// changes made elsewhere are not reported
+#ifndef PBSF_FOLLOW_POLL_MS
+#  define PBSF_FOLLOW_POLL_MS 5
+#endif
+
+namespace pbsf {
+
+inline
+namespace abiv1 {
+
+class follow_reader {
+
+public:
+
+  // the file may still be empty; its header is checked by the first next,
+  // which throws unknown_realm_error if it does not match the realm
+  template <class Realm>
+  follow_reader(const std::string& filename, Realm r)
+    : follow_reader(filename, realm_id(r))
+  {}
+
+  follow_reader(const follow_reader&) = delete;
+  follow_reader& operator=(const follow_reader&) = delete;
+
+  ~follow_reader();
+
+  // the next block, waiting for it to be written in full for at most
+  // timeout; false if it is not by then
+  bool next(EncodedBlock& block, std::chrono::milliseconds timeout);
+
+  // the same, waiting as long as it takes
+  bool next(EncodedBlock& block)
+  {
+    return next(block, std::chrono::milliseconds::max());
+  }
+
+  // file offset of the block last returned by next
+  std::streamoff offset() const
+  {
+    return block_offset;
+  }
+
+private:
+
+  int file;
+  int notify = -1;
+  uint32_t realm;
+  bool header_checked = false;
+  std::streamoff block_offset = 0;
+  // file contents from buf_base in [0, buf_end), not returned yet from
+  // buf_pos on
+  std::vector<char> buf;
+  std::streamoff buf_base = 0;
+  std::size_t buf_pos = 0;
+  std::size_t buf_end = 0;
+
+  follow_reader(const std::string& filename, uint32_t realm);
+
+  // reads what the file has grown by into buf; false if nothing
+  bool read_more();
+  // waits until the file may have grown, or until deadline
+  void wait(std::chrono::steady_clock::time_point deadline);
+
+};
+
+} // inline namespace abiv1
+
+} // namespace pbsf
+
+#endif /* BS3_PBSF_FOLLOW_HH */
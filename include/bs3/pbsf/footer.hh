@@ -0,0 +1,273 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSF_FOOTER_HH
+#define BS3_PBSF_FOOTER_HH
+
+// The optional footer of a sequential file: a block_table block after the
+// data, then a fixed-size marker block giving its position, which readers
+// find at the end of the file the way indexed files find their index.
+// Files without one, or whose footer does not check out, get the same
+// table by scanning block headers.
+
+#include <cstdint>
+#include <exception>
+#include <ios>
+#include <memory>
+#include <utility>
+
+#include <bs3/pbss/pbss.hh>
+
+#include "block-table.hh"
+#include "data-block.hh"
+#include "defs.hh"
+#include "realm.hh"
+
+namespace pbsf {
+
+namespace footer_impl {
+
+inline
+namespace abiv1 {
+
+struct block_table_marker {
+
+  int64_t pos;
+
+  PBSS_TUPLE_MEMBERS(
+    PBSS_TUPLE_MEMBER(&block_table_marker::pos));
+
+};
+
+PBSF_ABSTRACT_REALM(
+  footer_realm,
+  PBSF_REGISTER_TYPE(-20, block_table),
+  PBSF_REGISTER_TYPE(-21, block_table_marker));
+
+constexpr auto marker_size =
+  decltype(fixed_size(block_table_marker(), pbss::adl_ns_tag()))::value;
+constexpr auto marker_full_size =
+  sizeof(uint16_t)              // contentType
+  + sizeof(uint16_t)            // contentEncoding
+  + sizeof(uint32_t)            // contentChecksum
+  + static_size(pbss::make_var_uint(marker_size), pbss::adl_ns_tag())
+  + marker_size;
+
+constexpr auto file_header_size =
+  decltype(fixed_size(FileHeader(), pbss::adl_ns_tag()))::value;
+
+inline bool is_footer_type(int16_t type)
+{
+  return type == lookup_id<block_table>(footer_realm())
+    || type == lookup_id<block_table_marker>(footer_realm());
+}
+
+// reads the footer ending at size into t; false if there is none, or it
+// does not check out
+template <class Stream>
+bool read_footer(Stream& s, std::streamoff size, block_table& t)
+{
+  if (size < static_cast<std::streamoff>(file_header_size + marker_full_size))
+    return false;
+  block_table_marker marker;
+  try {
+    s.seekg(size - static_cast<std::streamoff>(marker_full_size));
+    auto block = pbss::parse<EncodedBlock>(s);
+    if (block.contentType != lookup_id<block_table_marker>(footer_realm()))
+      return false;
+    marker = pbss::parse_from_buffer<block_table_marker>(decode_block(std::move(block)));
+    if (marker.pos < static_cast<std::streamoff>(file_header_size) || marker.pos >= size)
+      return false;
+    s.seekg(marker.pos);
+    block = pbss::parse<EncodedBlock>(s);
+    if (block.contentType != lookup_id<block_table>(footer_realm())
+        || s.tellg() != size - static_cast<std::streamoff>(marker_full_size))
+      return false;
+    t = pbss::parse_from_buffer<block_table>(decode_block(std::move(block)));
+  } catch (const std::runtime_error&) {
+    s.clear();
+    return false;
+  }
+  if (t.group == 0 || t.end != marker.pos)
+    return false;
+  t.from_footer = true;
+  return true;
+}
+
+// the table of blocks in [from, size) by reading their headers; stops at
+// a block running past size
+template <class Stream>
+block_table scan_blocks(Stream& s, std::streamoff from, std::streamoff size)
+{
+  block_table t;
+  t.end = from;
+  s.seekg(from);
+  for (auto pos = from; pos < size; ) {
+    BlockHeader header;
+    try {
+      header = pbss::parse<BlockHeader>(s);
+    } catch (const std::runtime_error&) {
+      s.clear();
+      break;
+    }
+    if (s.eof()) {
+      s.clear();
+      break;
+    }
+    auto content = static_cast<std::streamoff>(s.tellg());
+    if (header.contentLength > static_cast<uint64_t>(size - content))
+      break;
+    if (!is_footer_type(header.contentType))
+      t.add(header.contentType, pos);
+    pos = content + static_cast<std::streamoff>(header.contentLength.v);
+    t.end = pos;
+    s.seekg(pos);
+  }
+  return t;
+}
+
+} // inline namespace abiv1
+
+} // namespace footer_impl
+
+inline
+namespace abiv1 {
+
+// appends the footer for t at the current position, which becomes t.end
+template <class Stream>
+void write_footer(Stream& s, block_table& t)
+{
+  using namespace footer_impl;
+  t.end = s.tellp();
+  write_block(s, footer_realm(), t);
+  using pbss::serialize;
+  serialize(s, encode_block(lookup_id<block_table_marker>(footer_realm()),
+                            pbss::serialize_to_buffer(block_table_marker{ t.end }),
+                            PBSF_ENCODING_IDENTITY));
+}
+
+// the table of blocks in a sequential file, from its footer or else by
+// scanning; leaves s at an unspecified position
+template <class Stream>
+block_table load_block_table(Stream& s)
+{
+  using namespace footer_impl;
+  s.seekg(0, std::ios_base::end);
+  std::streamoff size = s.tellg();
+  block_table t;
+  if (read_footer(s, size, t))
+    return t;
+  return scan_blocks(s, static_cast<std::streamoff>(file_header_size), size);
+}
+
+// positions s at the nth block of type, counting from 0; false, with s
+// unmoved, if there are not that many, or the blocks on the way run past
+// the end of s, as when t is stale or they are damaged
+template <class Stream>
+bool seek_block(Stream& s, const block_table& t, int16_t type, uint64_t n)
+{
+  auto where = t.locate(type, n);
+  if (where.first < 0)
+    return false;
+  std::streamoff from = s.tellg();
+  s.seekg(0, std::ios_base::end);
+  std::streamoff size = s.tellg();
+  auto pos = where.first;
+  for (auto skip = where.second; ; ) {
+    if (pos >= size) {
+      s.seekg(from);
+      return false;
+    }
+    s.seekg(pos);
+    BlockHeader header;
+    try {
+      header = pbss::parse<BlockHeader>(s);
+    } catch (const std::runtime_error&) {
+      s.clear();
+      s.seekg(from);
+      return false;
+    }
+    if (s.eof()) {
+      s.clear();
+      s.seekg(from);
+      return false;
+    }
+    auto content = static_cast<std::streamoff>(s.tellg());
+    if (header.contentLength > static_cast<uint64_t>(size - content)) {
+      s.seekg(from);
+      return false;
+    }
+    if (header.contentType == type && skip-- == 0)
+      break;
+    pos = content + static_cast<std::streamoff>(header.contentLength.v);
+  }
+  s.seekg(pos);
+  return true;
+}
+
+// writes the footer on finish(), or else when the last copy of the
+// sequential file holding it goes away
+template <class Stream>
+struct footer_writer {
+
+  std::shared_ptr<Stream> stream_ptr;
+  block_table table;
+  bool done = false;
+
+  footer_writer(std::shared_ptr<Stream> s, block_table t)
+    : stream_ptr(std::move(s)), table(std::move(t))
+  {}
+
+  footer_writer(const footer_writer&) = delete;
+  footer_writer& operator=(const footer_writer&) = delete;
+
+  // writes the footer and flushes the stream, throwing on errors; only
+  // the first call does anything
+  void finish()
+  {
+    if (done)
+      return;
+    done = true;
+    write_footer(*stream_ptr, table);
+    stream_ptr->flush();
+  }
+
+  // errors have nowhere to go from here, and while unwinding the blocks
+  // before the footer are suspect anyway, so it is left out
+  ~footer_writer()
+  {
+    if (done || std::uncaught_exceptions())
+      return;
+    try {
+      finish();
+    } catch (...) {
+    }
+  }
+
+};
+
+} // inline namespace abiv1
+
+} // namespace pbsf
+
+#endif /* BS3_PBSF_FOOTER_HH */
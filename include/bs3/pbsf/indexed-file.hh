@@ -29,7 +29,6 @@
 
 #include <cstdint>
 #include <ios>
-#include <fstream>
 #include <map>
 #include <memory>
 #include <utility>
@@ -43,6 +42,7 @@
 
 #include "realm.hh"
 #include "data-block.hh"
+#include "file-stream.hh"
 
 namespace pbsf {
 
@@ -400,17 +400,13 @@ struct indexed_file<Key, Stream, Realm, true>
 } // inline namespace abiv1
 
 template <class Key, class Realm>
-indexed_file<Key, std::fstream, Realm, true>
+indexed_file<Key, file_stream, Realm, true>
 open_indexed_output_file(const std::string& filename, Realm r, bool overwrite=true)
 {
-  using std::ios_base;
-  // refer to http://en.cppreference.com/w/cpp/io/basic_filebuf/open for
-  // these cryptic flags...
-  auto flag = ios_base::out | ios_base::in | ios_base::ate | (
-    overwrite ? ios_base::trunc : ios_base::app);
-  auto s = std::make_unique<std::fstream>(filename, flag);
-  s->exceptions(ios_base::failbit | ios_base::badbit);
-  if (static_cast<std::streamoff>(s->tellg()) == 0) {
+  auto s = std::make_unique<file_stream>(
+    filename, overwrite ? open_mode::overwrite : open_mode::update);
+  s->seekp(0, std::ios_base::end);
+  if (s->tellp() == 0) {
     write_header(*s, r);
     return { std::move(s), indexed_impl::blocks_index<Key>(), true };
   } else {
@@ -423,11 +419,10 @@ open_indexed_output_file(const std::string& filename, Realm r, bool overwrite=tr
 }
 
 template <class Key, class Realm>
-indexed_file<Key, std::ifstream, Realm>
+indexed_file<Key, file_stream, Realm>
 open_indexed_input_file(const std::string& filename, Realm r)
 {
-  auto s = std::make_unique<std::ifstream>(filename);
-  s->exceptions(std::ios_base::failbit | std::ios_base::badbit);
+  auto s = std::make_unique<file_stream>(filename, open_mode::read);
   if (!check_file(*s, r))
     throw unknown_realm_error();
   auto index = indexed_impl::read_current_index<Key>(*s, r);
@@ -31,6 +31,7 @@
 
 #include "file-header.hh"
 #include "data-block.hh"
+#include "file-stream.hh"
 
 #include "range-api.hh"
 
@@ -26,23 +26,36 @@
 
 // range-based API for manipulating files
 
-#include <fstream>
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <utility>
 
 #include <bs3/utils/range.hh>
 
+#include "block-table.hh"
 #include "data-block.hh"
+#include "file-stream.hh"
+#include "footer.hh"
+#include "reverse.hh"
 
 namespace pbsf {
 
 template <class T, class File>
-pbsu::range<skipping_read_iterator<typename File::realm_type, T>>
+pbsu::range<skipping_read_iterator<typename File::realm_type, T, typename File::stream_type>>
 read_one_type(File f);
 
 template <class File>
-heterogeneous_write_iterator<typename File::realm_type> write_iterator(File f);
+pbsu::range<heterogeneous_read_iterator<typename File::realm_type, typename File::stream_type>>
+read_all_types(File f);
+
+template <class File, class Visitor>
+void visit_all_types(File f, Visitor&& vis);
+
+template <class File>
+heterogeneous_write_iterator<typename File::realm_type, typename File::stream_type>
+write_iterator(File f);
 
 inline namespace abiv1 {
 
@@ -52,24 +65,84 @@ template <class Stream, class Realm> struct sequential_file {
     typedef Stream stream_type;
 
     std::shared_ptr<Stream> stream_ptr;
+    // blocks being written, when writing a footer; otherwise loaded by
+    // blocks() on first use
+    std::shared_ptr<block_table> table_ptr = nullptr;
+    // writes that footer
+    std::shared_ptr<footer_writer<Stream>> footer_ptr = nullptr;
 
     template <class T>
-    pbsu::range<skipping_read_iterator<realm_type, T>> read_one_type() {
+    pbsu::range<skipping_read_iterator<realm_type, T, stream_type>> read_one_type() {
         return pbsf::read_one_type<T>(*this);
     }
 
-    heterogeneous_write_iterator<realm_type> write_iterator() {
+    // the same, starting from the first-th value of T, counting from 0
+    template <class T>
+    pbsu::range<skipping_read_iterator<realm_type, T, stream_type>> read_one_type(uint64_t first) {
+        if (!seek_block(*stream_ptr, blocks(), lookup_id<T>(realm_type()), first))
+            stream_ptr->seekg(0, std::ios_base::end);
+        return pbsf::read_one_type<T>(*this);
+    }
+
+    // values of T from the last one backwards
+    template <class T>
+    pbsu::range<reverse_read_iterator<realm_type, T, stream_type>> read_one_type_reversed() {
+        return {{*stream_ptr, blocks()}, {}};
+    }
+
+    // the last n values of T, in file order
+    template <class T>
+    pbsu::range<skipping_read_iterator<realm_type, T, stream_type>> tail(uint64_t n) {
+        auto c = count<T>();
+        return read_one_type<T>(c > n ? c - n : 0);
+    }
+
+    // the blocks in the file, from its footer or by scanning it
+    const block_table& blocks() {
+        if (!table_ptr) {
+            std::streamoff pos = stream_ptr->tellg();
+            table_ptr = std::make_shared<block_table>(load_block_table(*stream_ptr));
+            stream_ptr->seekg(pos);
+        }
+        return *table_ptr;
+    }
+
+    // how many values of T there are
+    template <class T>
+    uint64_t count() {
+        return blocks().count(lookup_id<T>(realm_type()));
+    }
+
+    pbsu::range<heterogeneous_read_iterator<realm_type, stream_type>> read_all_types() {
+        return pbsf::read_all_types(*this);
+    }
+
+    template <class Visitor>
+    void visit_all_types(Visitor&& vis) {
+        pbsf::visit_all_types(*this, (Visitor&&)vis);
+    }
+
+    heterogeneous_write_iterator<realm_type, stream_type> write_iterator() {
         return pbsf::write_iterator(*this);
     }
+
+    // writes the footer, if any, and flushes the stream, throwing on
+    // errors that would be dropped if left to the destructors; nothing is
+    // to be written after
+    void finish() {
+        if (footer_ptr)
+            footer_ptr->finish();
+        else
+            stream_ptr->flush();
+    }
 };
 
 } // namespace abiv1
 
 template <class Realm>
-sequential_file<std::ifstream, Realm>
+sequential_file<file_stream, Realm>
 open_sequential_input_file(const std::string &filename, Realm r) {
-    auto s = std::make_shared<std::ifstream>(filename);
-    s->exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    auto s = std::make_shared<file_stream>(filename, open_mode::read);
     if (!check_file(*s, r))
         throw unknown_realm_error();
     return {s};
@@ -86,47 +159,71 @@ sequential_file<std::istream, Realm> open_sequential_input_file(std::istream &s,
 }
 
 template <class T, class File>
-pbsu::range<skipping_read_iterator<typename File::realm_type, T>>
+pbsu::range<skipping_read_iterator<typename File::realm_type, T, typename File::stream_type>>
 read_one_type(File f) {
     return {{*f.stream_ptr}, {}};
 }
 
+// every block of a type in the realm, in one pass, as realm_variant
+template <class File>
+pbsu::range<heterogeneous_read_iterator<typename File::realm_type, typename File::stream_type>>
+read_all_types(File f) {
+    return {{*f.stream_ptr}, {}};
+}
+
+// the same, calling vis with each value instead
+template <class File, class Visitor>
+void visit_all_types(File f, Visitor&& vis) {
+    for (block_read_iterator<typename File::stream_type> it(*f.stream_ptr), end;
+         it != end; ++it)
+        visit_block<typename File::realm_type>(std::move(*it), vis);
+}
+
+// with footer, a table of the blocks is written after them when the last
+// copy of the file goes away; appending to a file with a footer replaces it
 template <class Realm>
-sequential_file<std::fstream, Realm>
+sequential_file<file_stream, Realm>
 open_sequential_output_file(const std::string &filename, Realm r,
-                            bool overwrite = true) {
-    using std::ios_base;
-    auto flag = ios_base::out | ios_base::in | ios_base::ate |
-                (overwrite ? ios_base::trunc : ios_base::app);
-    auto s = std::make_shared<std::fstream>(filename, flag);
-    s->exceptions(std::ios_base::failbit | std::ios_base::badbit);
-    if (static_cast<std::streamoff>(s->tellg()) == 0) {
+                            bool overwrite = true, bool footer = false) {
+    auto s = std::make_shared<file_stream>(
+        filename, overwrite ? open_mode::overwrite : open_mode::update);
+    s->seekp(0, std::ios_base::end);
+    block_table table;
+    if (s->tellp() == 0) {
         write_header(*s, r);
-        return {s};
     } else {
         s->seekg(0);
         if (!check_file(*s, r))
             throw unknown_realm_error();
-        // Workaround a bug in system libraries on RHEL 6; I did not bother to
-        // locate the bug.  It seems like, even with app flag set, one must
-        // still manually seek to end.
-        s->seekp(0, ios_base::end);
-        return {s};
+        if (footer) {
+            table = load_block_table(*s);
+            if (table.from_footer)
+                s->truncate(table.end);
+        }
+        s->seekp(0, std::ios_base::end);
     }
+    if (!footer)
+        return {s};
+    auto w = std::make_shared<footer_writer<file_stream>>(s, std::move(table));
+    return {s, std::shared_ptr<block_table>(w, &w->table), w};
 }
 
 template <class Realm>
 sequential_file<std::ostream, Realm>
-open_sequential_output_file(std::ostream &s, Realm r) {
+open_sequential_output_file(std::ostream &s, Realm r, bool footer = false) {
     s.exceptions(std::ios_base::failbit | std::ios_base::badbit);
     write_header(s, r);
     std::shared_ptr<std::ostream> ss(&s, [](std::ostream*){});
-    return {ss};
+    if (!footer)
+        return {ss};
+    auto w = std::make_shared<footer_writer<std::ostream>>(ss, block_table());
+    return {ss, std::shared_ptr<block_table>(w, &w->table), w};
 }
 
 template <class File>
-heterogeneous_write_iterator<typename File::realm_type> write_iterator(File f) {
-    return {*f.stream_ptr};
+heterogeneous_write_iterator<typename File::realm_type, typename File::stream_type>
+write_iterator(File f) {
+    return {*f.stream_ptr, f.table_ptr.get()};
 }
 
 } // namespace pbsf
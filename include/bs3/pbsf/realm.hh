@@ -24,6 +24,9 @@
 #ifndef BS3_PBSF_REALM_HH
 #define BS3_PBSF_REALM_HH
 
+#include <array>
+#include <cstdint>
+
 namespace pbsf {
 
 inline
@@ -49,6 +52,21 @@ constexpr int16_t lookup_id(type_entry<id, T>)
   return id;
 }
 
+// ids of a realm, and of the types registered in it, for use at run time
+
+template <uint32_t id, class... entries>
+constexpr uint32_t realm_id(realm<id, entries...>)
+{
+  return id;
+}
+
+template <int16_t... ids, class... Ts>
+constexpr std::array<int16_t, sizeof...(ids)>
+type_ids(abstract_realm<type_entry<ids, Ts>...>)
+{
+  return { ids... };
+}
+
 #define PBSF_ABSTRACT_REALM(name, ...) \
   using name = ::pbsf::abstract_realm<__VA_ARGS__>
 
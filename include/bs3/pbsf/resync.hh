@@ -0,0 +1,114 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSF_RESYNC_HH
+#define BS3_PBSF_RESYNC_HH
+
+// Reading what is left of a damaged file.  Blocks are read in order as
+// usual; when one does not check out, the reader searches forward for the
+// next position holding a plausible block header whose content matches
+// its checksum, and records the bytes in between as damaged.  Blocks found
+// that way which are directly followed by more damage are checksummed from
+// a budget of PBSF_RESYNC_UNCONFIRMED bytes per search (64 MiB by
+// default); longer ones are lost with the damage.
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <string>
+#include <vector>
+
+#include "defs.hh"
+#include "file-stream.hh"
+#include "realm.hh"
+
+namespace pbsf {
+
+inline
+namespace abiv1 {
+
+struct damaged_range {
+  std::streamoff first;
+  std::streamoff last;          // one past
+};
+
+class resync_reader {
+
+public:
+
+  // opens the file, throwing unknown_realm_error if its header does not
+  // match the realm
+  template <class Realm>
+  resync_reader(const std::string& filename, Realm r)
+    : resync_reader(filename, realm_id(r), type_ids(r).data(), type_ids(r).size())
+  {}
+
+  // the next intact block, skipping damage; false at end of file
+  bool next(EncodedBlock& block);
+
+  // continues from the first intact block of a type in the realm at or
+  // after the given offset, without counting what is skipped as damage;
+  // returns its offset, or the file size if there is none
+  std::streamoff seek(std::streamoff at);
+
+  // file offset of the block last returned by next
+  std::streamoff offset() const
+  {
+    return block_offset;
+  }
+
+  // damage skipped so far, in file order
+  const std::vector<damaged_range>& damaged() const
+  {
+    return damage;
+  }
+
+private:
+
+  file_stream in;
+  std::streamoff size;
+  // just after the file header
+  std::streamoff first;
+  std::streamoff pos;
+  std::streamoff block_offset = 0;
+  std::vector<damaged_range> damage;
+  // a block found while scanning starts with a type of the realm
+  std::bitset<65536> known_types;
+  std::vector<char> window;
+  // left to checksum in this search for blocks followed by damage
+  std::size_t unconfirmed = 0;
+
+  resync_reader(const std::string& filename, uint32_t realm,
+                const int16_t* types, std::size_t ntypes);
+
+  bool read_block_at(std::streamoff at, EncodedBlock& block, bool scanning);
+  std::streamoff resync(std::streamoff from, EncodedBlock& block);
+
+};
+
+} // inline namespace abiv1
+
+} // namespace pbsf
+
+#endif /* BS3_PBSF_RESYNC_HH */
@@ -0,0 +1,232 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSF_REVERSE_HH
+#define BS3_PBSF_REVERSE_HH
+
+// Reading a sequential file backwards, from its last block.  The offsets
+// sampled in a block_table cut the file into chunks of at most a group of
+// blocks of each type; the chunks are taken from the last, each read
+// forwards once, and its blocks returned last first.  With a footer, the
+// last blocks are thus found without reading the rest of the file.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ios>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <bs3/pbss/pbss.hh>
+
+#include <bs3/utils/iter-util.hh>
+
+#include "block-table.hh"
+#include "data-block.hh"
+#include "defs.hh"
+#include "footer.hh"
+#include "realm.hh"
+
+// blocks up to this long are kept in memory while reading a chunk; longer
+// ones are read again when returned
+#ifndef PBSF_REVERSE_KEEP_SIZE
+#  define PBSF_REVERSE_KEEP_SIZE (std::size_t(1)<<16)
+#endif
+
+namespace pbsf {
+
+inline
+namespace abiv1 {
+
+template <class Stream>
+struct reverse_block_iterator {
+
+  typedef std::input_iterator_tag iterator_category;
+  typedef EncodedBlock value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef EncodedBlock& reference;
+  typedef EncodedBlock* pointer;
+
+private:
+
+  struct entry {
+    std::streamoff offset;
+    bool kept;
+    EncodedBlock block;
+  };
+
+  Stream* stream_ptr;
+  bool all_types;
+  int16_t type;
+  // starts of the chunks not read yet, ascending
+  std::shared_ptr<std::vector<int64_t>> starts;
+  std::streamoff chunk_end;
+  // blocks of the chunk not returned yet
+  std::vector<entry> chunk;
+  mutable EncodedBlock value;
+
+public:
+
+  reverse_block_iterator()
+    : stream_ptr(0)
+  {}
+
+  // every block in t
+  reverse_block_iterator(Stream& s, const block_table& t)
+    : stream_ptr(&s), all_types(true), type(0),
+      starts(std::make_shared<std::vector<int64_t>>()), chunk_end(t.end)
+  {
+    for (auto& x : t.types)
+      starts->insert(starts->end(), x.second.samples.begin(), x.second.samples.end());
+    std::sort(starts->begin(), starts->end());
+    ++(*this);
+  }
+
+  // the blocks of one type in t
+  reverse_block_iterator(Stream& s, const block_table& t, int16_t type)
+    : stream_ptr(&s), all_types(false), type(type),
+      starts(std::make_shared<std::vector<int64_t>>()), chunk_end(t.end)
+  {
+    auto it = t.types.find(type);
+    if (it != t.types.end())
+      *starts = it->second.samples;
+    ++(*this);
+  }
+
+  reverse_block_iterator& operator++()
+  {
+    while (chunk.empty() && !starts->empty()) {
+      auto first = starts->back();
+      starts->pop_back();
+      read_chunk(first);
+      chunk_end = first;
+    }
+    if (chunk.empty()) {
+      stream_ptr = 0;
+      return *this;
+    }
+    auto& e = chunk.back();
+    if (e.kept) {
+      value = std::move(e.block);
+    } else {
+      stream_ptr->seekg(e.offset);
+      value = pbss::parse<EncodedBlock>(*stream_ptr);
+    }
+    chunk.pop_back();
+    return *this;
+  }
+
+  reverse_block_iterator operator++(int)
+  {
+    auto copy = *this;
+    ++*this;
+    return copy;
+  }
+
+  bool operator==(const reverse_block_iterator& other) const
+  {
+    return stream_ptr == other.stream_ptr;
+  }
+
+  bool operator!=(const reverse_block_iterator& other) const
+  {
+    return !((*this) == other);
+  }
+
+  reference operator*() const
+  {
+    return value;
+  }
+
+  pointer operator->() const
+  {
+    return std::addressof(value);
+  }
+
+private:
+
+  void read_chunk(std::streamoff first)
+  {
+    auto& s = *stream_ptr;
+    s.seekg(first);
+    for (auto pos = first; pos < chunk_end; ) {
+      auto header = pbss::parse<BlockHeader>(s);
+      std::streamoff content = s.tellg();
+      auto length = static_cast<std::size_t>(header.contentLength);
+      bool wanted = all_types
+        ? !footer_impl::is_footer_type(header.contentType)
+        : header.contentType == type;
+      auto next = content + static_cast<std::streamoff>(length);
+      if (wanted && length <= PBSF_REVERSE_KEEP_SIZE) {
+        entry e { pos, true, {} };
+        e.block.contentType = header.contentType;
+        e.block.contentEncoding = header.contentEncoding;
+        e.block.contentChecksum = header.contentChecksum;
+        e.block.content.resize(length);
+        s.read(reinterpret_cast<char*>(e.block.content.data()),
+               static_cast<std::streamsize>(length));
+        // shorter than the table says, as when truncated meanwhile
+        if (s.eof())
+          throw pbss::early_eof_error();
+        chunk.push_back(std::move(e));
+      } else {
+        if (wanted)
+          chunk.push_back({ pos, false, {} });
+        s.seekg(next);
+      }
+      pos = next;
+    }
+  }
+
+};
+
+// values of T, from the last
+template <class Realm, class T, class Stream = std::istream>
+struct reverse_read_iterator
+  : public pbsu::mapping_iterator<
+      iter_impl::parse_from_block<T>, reverse_block_iterator<Stream>, true> {
+
+private:
+
+  using base = pbsu::mapping_iterator<
+    iter_impl::parse_from_block<T>, reverse_block_iterator<Stream>, true>;
+
+public:
+
+  reverse_read_iterator()
+    : base({}, {})
+  {}
+
+  reverse_read_iterator(Stream& s, const block_table& t)
+    : base({}, { s, t, lookup_id<T>(Realm()) })
+  {}
+
+};
+
+} // inline namespace abiv1
+
+} // namespace pbsf
+
+#endif /* BS3_PBSF_REVERSE_HH */
@@ -0,0 +1,275 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSF_SHM_RING_HH
+#define BS3_PBSF_SHM_RING_HH
+
+// Carrying a sequential file through a ring buffer in POSIX shared memory
+// instead of the file system, from one writer to up to PBSF_SHM_MAX_READERS
+// readers (16 by default) attached at once on the same host; attaching
+// another throws.  The bytes are the same as in a file: the realm header,
+// then EncodedBlocks, so the range API reads and writes them unchanged
+// through ring_reader and ring_writer streams.
+//
+// Each block written by write_block is published as one frame, taking no
+// system call unless a reader is asleep waiting for data; frames are
+// never split, so readers never see part of a block.  When the ring is
+// full the writer either waits for the slowest reader, or overwrites the
+// oldest frames, which readers that fall behind then skip.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <bs3/utils/misc.hh>
+
+#include "defs.hh"
+#include "range-api.hh"
+#include "realm.hh"
+
+#ifndef PBSF_SHM_RING_SIZE
+#  define PBSF_SHM_RING_SIZE (std::size_t(1)<<24)
+#endif
+
+// readers attached at once
+#ifndef PBSF_SHM_MAX_READERS
+#  define PBSF_SHM_MAX_READERS 16
+#endif
+
+// longest sleep between checks that the other side is still alive
+#ifndef PBSF_SHM_POLL_MS
+#  define PBSF_SHM_POLL_MS 100
+#endif
+
+namespace pbsf {
+
+namespace shm_impl {
+
+struct ring_control;
+
+} // namespace shm_impl
+
+inline
+namespace abiv1 {
+
+enum class overflow_policy {
+  block,                        // the writer waits for the slowest reader
+  drop,                         // the oldest frames are overwritten
+};
+
+struct ring_options {
+  // rounded up to a power of two
+  std::size_t capacity = PBSF_SHM_RING_SIZE;
+  overflow_policy overflow = overflow_policy::block;
+};
+
+class ring_writer {
+
+public:
+
+  // creates the ring, replacing any of the same name; name is as for
+  // shm_open, e.g. "/daq-events"
+  ring_writer(const std::string& name, uint32_t realm, ring_options options = {});
+
+  ring_writer(const ring_writer&) = delete;
+  ring_writer& operator=(const ring_writer&) = delete;
+
+  // publishes what is pending, tells readers there is no more, and
+  // removes the name; readers attached can still read what is left
+  ~ring_writer();
+
+  ring_writer& put(char ch)
+  {
+    frame.push_back(ch);
+    return *this;
+  }
+
+  ring_writer& write(const char* src, std::streamsize count)
+  {
+    frame.insert(frame.end(), src, src + count);
+    return *this;
+  }
+
+  // publishes what has been written since the last frame as one; called
+  // by write_block after each block
+  void end_block();
+
+  ring_writer& flush()
+  {
+    end_block();
+    return *this;
+  }
+
+  // bytes written so far, not counting the header
+  std::streamoff tellp() const
+  {
+    return written + static_cast<std::streamoff>(frame.size());
+  }
+
+private:
+
+  std::string name;
+  shm_impl::ring_control* ctl;
+  char* data;
+  std::size_t mapped;
+  uint64_t capacity;
+  overflow_policy overflow;
+  std::vector<char> frame;
+  std::streamoff written = 0;
+  // how far frames fit without looking at the readers again: the slowest
+  // one's position plus the capacity, when last looked at; readers
+  // attaching later start further on
+  uint64_t room_until = 0;
+
+  void wait_for_space(uint64_t need);
+
+};
+
+class ring_reader {
+
+public:
+
+  typedef std::char_traits<char> traits_type;
+  typedef traits_type::int_type int_type;
+
+  // attaches to the ring, reading the frames published from now on, after
+  // the realm header
+  explicit ring_reader(const std::string& name);
+
+  ring_reader(const ring_reader&) = delete;
+  ring_reader& operator=(const ring_reader&) = delete;
+
+  ~ring_reader();
+
+  // as file_stream; a read waits for the writer, and runs out of input
+  // only once the writer has gone and everything is read
+
+  ring_reader& read(char* dest, std::streamsize count)
+  {
+    if (BS3_LIKELY(pbsu::to_unsigned(count) <= buf.size() - pos)) {
+      std::memcpy(dest, buf.data() + pos, pbsu::to_unsigned(count));
+      pos += pbsu::to_unsigned(count);
+    } else read_slow(dest, count);
+    return *this;
+  }
+
+  int_type get()
+  {
+    if (BS3_LIKELY(pos != buf.size()))
+      return traits_type::to_int_type(buf[pos++]);
+    return get_slow();
+  }
+
+  int_type peek()
+  {
+    if (BS3_LIKELY(pos != buf.size()))
+      return traits_type::to_int_type(buf[pos]);
+    return peek_slow();
+  }
+
+  void ignore(std::streamsize count)
+  {
+    if (BS3_LIKELY(pbsu::to_unsigned(count) <= buf.size() - pos))
+      pos += pbsu::to_unsigned(count);
+    else ignore_slow(count);
+  }
+
+  const char* lookahead(std::streamsize count)
+  {
+    if (BS3_LIKELY(pbsu::to_unsigned(count) <= buf.size() - pos))
+      return buf.data() + pos;
+    return lookahead_slow(count);
+  }
+
+  bool eof() const
+  {
+    return at_eof;
+  }
+
+  void clear()
+  {
+    at_eof = false;
+  }
+
+  // bytes of frames overwritten before they could be read
+  uint64_t dropped() const
+  {
+    return dropped_bytes;
+  }
+
+private:
+
+  shm_impl::ring_control* ctl;
+  const char* data;
+  std::size_t mapped;
+  uint64_t capacity;
+  std::size_t slot;
+  uint64_t tail;
+  uint64_t dropped_bytes = 0;
+  // frames read out of the ring, not consumed yet in [pos, end)
+  std::vector<char> buf;
+  std::size_t pos = 0;
+  bool at_eof = false;
+
+  void read_slow(char* dest, std::streamsize count);
+  int_type get_slow();
+  int_type peek_slow();
+  void ignore_slow(std::streamsize count);
+  const char* lookahead_slow(std::streamsize count);
+
+  // makes count chars available in buf unless the writer has gone; false
+  // if not
+  bool fill(std::size_t count);
+  // reads the next frame into buf; false if the writer has gone
+  bool next_frame();
+
+};
+
+} // inline namespace abiv1
+
+// the ring as a sequential file being written
+template <class Realm>
+sequential_file<ring_writer, Realm>
+open_ring_output(const std::string& name, Realm r, ring_options options = {})
+{
+  return { std::make_shared<ring_writer>(name, realm_id(r), options) };
+}
+
+// attaches to a ring as a sequential file being read
+template <class Realm>
+sequential_file<ring_reader, Realm>
+open_ring_input(const std::string& name, Realm r)
+{
+  auto s = std::make_shared<ring_reader>(name);
+  if (!check_file(*s, r))
+    throw unknown_realm_error();
+  return { s };
+}
+
+} // namespace pbsf
+
+#endif /* BS3_PBSF_SHM_RING_HH */
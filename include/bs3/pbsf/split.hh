@@ -0,0 +1,109 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSF_SPLIT_HH
+#define BS3_PBSF_SPLIT_HH
+
+// Splitting a sequential file into byte ranges of about equal size that
+// each start at a block, to be read independently, e.g. by several threads
+// or processes.  The ranges cover the data without overlap, so every block
+// is read from exactly one of them.  Block starts come from the footer
+// when the file has one (see footer.hh), and otherwise from searching for
+// an intact block at each cut, as resync_reader does.
+
+#include <cstddef>
+#include <ios>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "block-table.hh"
+#include "defs.hh"
+#include "file-header.hh"
+#include "file-stream.hh"
+#include "footer.hh"
+#include "range-api.hh"
+#include "realm.hh"
+#include "resync.hh"
+
+namespace pbsf {
+
+inline
+namespace abiv1 {
+
+struct file_range {
+  std::streamoff first;
+  std::streamoff last;          // one past
+};
+
+} // inline namespace abiv1
+
+namespace split_impl {
+
+// the cuts, with ranges given as [first, last) of the data
+std::vector<file_range> split_by_table(const block_table& t, std::streamoff first,
+                                       std::size_t k);
+std::vector<file_range> split_by_resync(resync_reader& r, std::streamoff first,
+                                        std::streamoff last, std::size_t k);
+
+} // namespace split_impl
+
+inline
+namespace abiv1 {
+
+// at most k ranges, in file order; fewer if the file has fewer places to
+// cut, and none if it has no blocks
+template <class Realm>
+std::vector<file_range> split_file(const std::string& filename, Realm r, std::size_t k)
+{
+  file_stream s(filename, open_mode::read, 1<<16);
+  if (!check_file(s, r))
+    throw unknown_realm_error();
+  std::streamoff first = s.tellg();
+  s.seekg(0, std::ios_base::end);
+  std::streamoff size = s.tellg();
+  block_table t;
+  if (footer_impl::read_footer(s, size, t))
+    return split_impl::split_by_table(t, first, k);
+  resync_reader reader(filename, r);
+  return split_impl::split_by_resync(reader, first, size, k);
+}
+
+// a sequential file reading only the blocks in range
+template <class Realm>
+sequential_file<file_stream, Realm>
+open_file_range(const std::string& filename, Realm r, file_range range)
+{
+  auto s = std::make_shared<file_stream>(filename, open_mode::read);
+  if (!check_file(*s, r))
+    throw unknown_realm_error();
+  s->limit(range.last);
+  s->seekg(range.first);
+  return {s};
+}
+
+} // inline namespace abiv1
+
+} // namespace pbsf
+
+#endif /* BS3_PBSF_SPLIT_HH */
@@ -0,0 +1,78 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSF_VERIFY_HH
+#define BS3_PBSF_VERIFY_HH
+
+// Whole-file integrity check: finds all blocks from their headers alone,
+// then checks their contents on a pool of threads with positional reads.
+
+#include <cstdint>
+#include <ios>
+#include <string>
+#include <vector>
+
+#include "defs.hh"
+
+namespace pbsf {
+
+inline
+namespace abiv1 {
+
+struct verify_options {
+  // threads reading and checking blocks; 0 for one per core
+  unsigned threads = 0;
+  // also check that each block decodes, not only its checksum
+  bool decode = false;
+};
+
+struct block_error {
+  // file offset of the block, or of where the file stops making sense
+  std::streamoff offset;
+  int16_t contentType;
+  std::string what;
+};
+
+struct verify_result {
+  uint32_t realm = 0;
+  uint64_t blocks = 0;
+  uint64_t bytes = 0;
+  // by offset; a bad file header or a block running past the end of file
+  // ends the scan, and is the last error
+  std::vector<block_error> errors;
+
+  bool ok() const
+  {
+    return errors.empty();
+  }
+};
+
+// Does not throw for problems in the file's contents, only for failing to
+// read it.
+verify_result verify_file(const std::string& filename, const verify_options& options = {});
+
+} // inline namespace abiv1
+
+} // namespace pbsf
+
+#endif /* BS3_PBSF_VERIFY_HH */
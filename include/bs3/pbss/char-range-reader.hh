@@ -82,11 +82,99 @@ public:
     current += count;
   }
 
+  // consume count chars without copying them; the returned pointer aims
+  // into the underlying range.  Returns null if the range ends early, and
+  // eof() is true thereafter.  Negative counts fail the same way.
+  const Char* borrow(std::streamsize count)
+  {
+    if (count < 0 || count > end - current) {
+      current = end + 1;
+      return nullptr;
+    }
+    auto cur = current;
+    current += count;
+    return cur;
+  }
+
+  // peek at the next count chars without consuming them; null if the range
+  // is shorter than that
+  const Char* lookahead(std::streamsize count) const
+  {
+    if (count > end - current)
+      return nullptr;
+    return current;
+  }
+
+};
+
+// The same with no bound checks on reads, for input known to parse within
+// the range, e.g. by validate<T>; eof() is always false.  lookahead may
+// fail by design, so it is still checked.
+template <class Char, class Traits=std::char_traits<Char> >
+struct basic_unchecked_char_range_reader {
+
+private:
+
+  const Char* current;
+  const Char* end;
+
+public:
+
+  basic_unchecked_char_range_reader(const Char* first, const Char* last)
+    : current(first), end(last)
+  {}
+
+  basic_unchecked_char_range_reader& read(Char* dest, std::streamsize count)
+  {
+    Traits::copy(dest, current, to_unsigned(count));
+    current += count;
+    return *this;
+  }
+
+  bool eof() const
+  {
+    return false;
+  }
+
+  typename Traits::int_type
+  get()
+  {
+    return Traits::to_int_type(*current++);
+  }
+
+  typename Traits::int_type
+  peek()
+  {
+    if (current >= end)
+      return Traits::eof();
+    return Traits::to_int_type(*current);
+  }
+
+  void ignore(std::streamsize count)
+  {
+    current += count;
+  }
+
+  const Char* borrow(std::streamsize count)
+  {
+    auto cur = current;
+    current += count;
+    return cur;
+  }
+
+  const Char* lookahead(std::streamsize count) const
+  {
+    if (count > end - current)
+      return nullptr;
+    return current;
+  }
+
 };
 
 } // inline namespace chrange_abiv1
 
 using char_range_reader = basic_char_range_reader<char>;
+using unchecked_char_range_reader = basic_unchecked_char_range_reader<char>;
 
 } // namespace pbss
 
@@ -58,6 +58,14 @@ public:
     return *this;
   }
 
+  // take the next count chars to be filled by the caller
+  Char* claim(std::streamsize count)
+  {
+    auto p = ptr;
+    ptr += count;
+    return p;
+  }
+
   Char* pptr() const
   {
     return ptr;
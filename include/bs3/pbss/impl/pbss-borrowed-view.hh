@@ -0,0 +1,85 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSS_BORROWED_VIEW_HH
+#define BS3_PBSS_BORROWED_VIEW_HH
+
+// std::span<const T> and std::basic_string_view parse to views pointing
+// into the input, without copying.  They serialize like any other
+// contiguous sequence, so no serialize overload is needed here.
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+namespace pbss {
+
+namespace borrow_impl {
+
+template <class T>
+struct borrowed_element {};
+
+template <class T>
+struct borrowed_element<std::span<const T>> {
+  using type = T;
+};
+
+template <class Char, class Traits>
+struct borrowed_element<std::basic_string_view<Char, Traits>> {
+  using type = Char;
+};
+
+// a view can borrow only elements stored as-is
+template <class T>
+auto check_borrowed_view() -> typename std::enable_if<
+  is_memory_layout<typename borrowed_element<T>::type>::value,
+  T>::type;
+
+} // namespace borrow_impl
+
+// only streams that can lend out their storage, like char_range_reader,
+// are supported; the result is valid as long as that storage is
+template <class T, class Stream>
+auto parse(Stream& stream) -> decltype(
+  borrow_impl::check_borrowed_view<T>(),
+  stream.borrow(std::streamsize()),
+  T())
+{
+  using elem = typename borrow_impl::borrowed_element<T>::type;
+  auto size = parse<pbss::var_uint<std::size_t>>(stream).v;
+  // no stream holds more, and the byte count must not wrap around
+  if (BS3_UNLIKELY(size > to_unsigned(std::numeric_limits<std::streamsize>::max()) / sizeof(elem)))
+    throw early_eof_error();
+  auto ptr = stream.borrow(to_signed(sizeof(elem) * size));
+  if (BS3_UNLIKELY(!ptr))
+    throw early_eof_error();
+  if (BS3_UNLIKELY(reinterpret_cast<std::uintptr_t>(ptr) % alignof(elem)))
+    throw unaligned_view_error();
+  return T(reinterpret_cast<const elem*>(ptr), size);
+}
+
+} // namespace pbss
+
+#endif /* BS3_PBSS_BORROWED_VIEW_HH */
@@ -47,6 +47,10 @@ auto fixed_size(const T&, adl_ns_tag) -> decltype(
   typename std::enable_if<std::is_enum<T>::value, std::size_t>::type(),
   std::integral_constant<std::size_t, sizeof(T)>());
 
+template <class T>
+struct is_memory_layout<T, typename std::enable_if<std::is_enum<T>::value>::type>
+  : std::true_type {};
+
 }
 
 #endif /* BS3_PBSS_ENUM_HH */
@@ -0,0 +1,188 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSS_PARALLEL_HH
+#define BS3_PBSS_PARALLEL_HH
+
+// Parallel parsing reads with a parallel_reader, a range reader carrying
+// the number of threads to use.  Sequences are first scanned for element
+// boundaries with skip(), which hops over tagged members by their stored
+// lengths; if the elements span enough bytes, they are then parsed
+// concurrently into the pre-sized container, each from its own range.
+// Elements parsed concurrently are themselves parsed sequentially.
+//
+// Parallel serialization is the reverse: with a parallel_writer, which
+// also knows where the buffer ends, sizes of elements are computed ahead
+// of time, and elements are serialized concurrently into their own ranges
+// of the buffer.
+
+#include <algorithm>
+#include <vector>
+
+#include <bs3/utils/parallel.hh>
+
+#include "../char-range-reader.hh"
+#include "../char-range-writer.hh"
+
+// least number of bytes in a sequence for its elements to be parsed in
+// parallel
+#ifndef PBSS_PARALLEL_PARSE_THRESHOLD
+#  define PBSS_PARALLEL_PARSE_THRESHOLD (1<<20)
+#endif
+
+// and serialized in parallel
+#ifndef PBSS_PARALLEL_SERIALIZE_THRESHOLD
+#  define PBSS_PARALLEL_SERIALIZE_THRESHOLD (1<<20)
+#endif
+
+namespace pbss {
+
+namespace parallel_impl {
+
+struct parallel_reader : char_range_reader {
+
+  unsigned threads;
+
+  parallel_reader(const char* first, const char* last, unsigned n)
+    : char_range_reader(first, last), threads(n)
+  {}
+
+};
+
+// found by ADL from parse_cont_impl, for the elements that would be parsed
+// one by one there; only containers handing out real references, as
+// neighbours behind a proxy like std::vector<bool>'s share storage
+template <class T>
+auto read_each(parallel_reader& stream, T& coll, typename T::size_type size, int /* preferred */)
+  -> typename std::enable_if<
+    !vuint_impl::is_vuint<typename T::value_type>::value
+    && std::is_same<decltype(coll[size]), typename T::value_type&>::value,
+    decltype(coll.resize(size), void())>::type
+{
+  using value_type = typename T::value_type;
+  // too few elements, threads or remaining input to try
+  if (size < 2 || stream.threads < 2 || !stream.lookahead(PBSS_PARALLEL_PARSE_THRESHOLD))
+    return parse_cont_impl::read_each(stream, coll, size, long());
+
+  std::vector<const char*> bounds(size+1);
+  for (decltype(size) i=0; i!=size; ++i) {
+    bounds[i] = stream.borrow(0);
+    skip<value_type>(stream);
+  }
+  bounds[size] = stream.borrow(0);
+  if (BS3_UNLIKELY(!bounds[size]))
+    throw early_eof_error();
+
+  auto bytes = to_unsigned(bounds[size] - bounds[0]);
+  if (bytes < PBSS_PARALLEL_PARSE_THRESHOLD) {
+    // nothing nested can be larger, so parse all sequentially
+    char_range_reader reader(bounds[0], bounds[size]);
+    return parse_cont_impl::read_each(reader, coll, size, long());
+  }
+
+  coll.resize(size);
+  // split by bytes, as elements may differ much in size
+  auto threads = static_cast<unsigned>(std::min<std::size_t>(stream.threads, size));
+  auto split = [&](unsigned k) {
+    if (k == threads)
+      return std::size_t(size);
+    auto it = std::lower_bound(bounds.begin(), bounds.end()-1, bounds[0] + bytes/threads*k);
+    return std::size_t(it - bounds.begin());
+  };
+  pbsu::run_parallel(threads, [&](unsigned k) {
+      for (auto i = split(k), last = split(k+1); i < last; ++i) {
+        char_range_reader reader(bounds[i], bounds[i+1]);
+        coll[i] = parse<value_type>(reader);
+      }
+    });
+}
+
+struct parallel_writer : char_range_writer {
+
+  char* end;
+  unsigned threads;
+
+  parallel_writer(char* first, char* last, unsigned n)
+    : char_range_writer(first), end(last), threads(n)
+  {}
+
+};
+
+// found by ADL from homoseq_impl, for the elements that would be
+// serialized one by one there
+template <class T>
+auto write_each(parallel_writer& stream, const T& coll, int /* preferred */)
+  -> typename std::enable_if<
+    !vuint_impl::is_vuint<decltype(homoseq_impl::value_type_of(coll))>::value
+    // elements are kept by address
+    && std::is_lvalue_reference<decltype(*std::begin(coll))>::value,
+    decltype(aot_size(*std::begin(coll), adl_ns_tag()), void())>::type
+{
+  using homoseq_impl::pbss_size;
+  auto size = pbss_size(coll);
+  // too few elements, threads or remaining space to try
+  if (size < 2 || stream.threads < 2
+      || stream.end - stream.pptr() < PBSS_PARALLEL_SERIALIZE_THRESHOLD)
+    return homoseq_impl::write_each(stream, coll, 0);
+
+  // offsets of elements
+  std::vector<std::size_t> bounds(size+1);
+  std::vector<const decltype(homoseq_impl::value_type_of(coll))*> elems(size);
+  std::size_t i = 0;
+  for (auto&& v : coll) {
+    elems[i] = &v;
+    bounds[i+1] = bounds[i] + aot_size(v, adl_ns_tag());
+    ++i;
+  }
+  auto bytes = bounds[size];
+  auto dest = stream.claim(to_signed(bytes));
+  auto write_range = [&](std::size_t first, std::size_t last) {
+    char_range_writer writer(dest + bounds[first]);
+    for (auto j = first; j != last; ++j)
+      serialize(writer, *elems[j]);
+  };
+  if (bytes < PBSS_PARALLEL_SERIALIZE_THRESHOLD)
+    // nothing nested can be larger, so serialize all sequentially
+    return write_range(0, size);
+
+  // split by bytes, as elements may differ much in size
+  auto threads = static_cast<unsigned>(std::min<std::size_t>(stream.threads, size));
+  auto split = [&](unsigned k) {
+    if (k == threads)
+      return std::size_t(size);
+    auto it = std::lower_bound(bounds.begin(), bounds.end()-1, bytes/threads*k);
+    return std::size_t(it - bounds.begin());
+  };
+  pbsu::run_parallel(threads, [&](unsigned k) {
+      write_range(split(k), split(k+1));
+    });
+}
+
+} // namespace parallel_impl
+
+using parallel_impl::parallel_reader;
+using parallel_impl::parallel_writer;
+
+} // namespace pbss
+
+#endif /* BS3_PBSS_PARALLEL_HH */
@@ -40,13 +40,33 @@ auto check_sequential_container() -> decltype(
   T());
 
 template <class T, class X>
-auto maybe_insert(size_t, T& c, X&& x)
+auto insert_one(T& c, X&& x, long /* generic */)
   -> decltype(c.insert((X&&)x),
               void())
 {
   c.insert((X&&)x);
 }
 
+// ordered containers are hinted at the end; input written from one is
+// already sorted, so each insert takes amortized constant time instead of a
+// search
+template <class T, class X>
+auto insert_one(T& c, X&& x, int /* preferred */)
+  -> decltype(std::declval<typename T::key_compare>(),
+              c.insert(c.end(), (X&&)x),
+              void())
+{
+  c.insert(c.end(), (X&&)x);
+}
+
+template <class T, class X>
+auto maybe_insert(size_t, T& c, X&& x)
+  -> decltype(insert_one(c, (X&&)x, 0),
+              void())
+{
+  insert_one(c, (X&&)x, 0);
+}
+
 template <class T, size_t N, class X>
 void maybe_insert(size_t i, std::array<T, N>& c, X&& x)
 {
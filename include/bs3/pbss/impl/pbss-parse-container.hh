@@ -26,6 +26,7 @@
 
 #include "pbss-parse-container-fwd.hh"
 
+#include <algorithm>
 #include <type_traits>
 
 #include "../var-uint.hh"
@@ -48,26 +49,44 @@ void reserve_if_applicable(T...)
 
 using pbss::homoseq_impl::is_contiguous_container;
 
+template <class Collection, class Size_t>
+auto resize_if_applicable(Collection& coll, Size_t size) -> decltype(coll.resize(size))
+{
+  return coll.resize(size);
+}
+
+template <class... T>
+void resize_if_applicable(T...)
+{}
+
 template <class T, class Stream>
-T parse_elems(Stream& stream, typename T::size_type size,
-              std::false_type /* cannot simply read */)
+void read_each(Stream& stream, T& coll, typename T::size_type size, long /* generic */)
 {
-  typename std::remove_const<T>::type coll;
   reserve_if_applicable(coll, size);
   for (decltype(size) i=0; i!=size; ++i)
     coll.push_back(parse<typename T::value_type>(stream));
-  return coll;
 }
 
-template <class Collection, class Size_t>
-auto resize_if_applicable(Collection& coll, Size_t size) -> decltype(coll.resize(size))
+// var uints are decoded in bulk
+template <class T, class Stream>
+auto read_each(Stream& stream, T& coll, typename T::size_type size, int /* preferred */)
+  -> typename std::enable_if<
+    vuint_impl::is_vuint<typename T::value_type>::value && is_contiguous_container<T>()>::type
 {
-  return coll.resize(size);
+  using pbss::homoseq_impl::begin_pointer_of;
+  resize_if_applicable(coll, size);
+  if (size)
+    vuint_impl::read_var_uints(stream, begin_pointer_of(coll), size, 0);
 }
 
-template <class... T>
-void resize_if_applicable(T...)
-{}
+template <class T, class Stream>
+T parse_elems(Stream& stream, typename T::size_type size,
+              std::false_type /* cannot simply read */)
+{
+  typename std::remove_const<T>::type coll;
+  read_each(stream, coll, size, 0);
+  return coll;
+}
 
 template <class T, class Stream>
 T parse_elems(Stream& stream, typename T::size_type size,
@@ -85,6 +104,64 @@ T parse_elems(Stream& stream, typename T::size_type size,
   return coll;
 }
 
+template <class T, class Stream>
+void insert_each(Stream& stream, T& coll, typename T::size_type size, long /* generic */)
+{
+  reserve_if_applicable(coll, size);
+  for (decltype(size) i=0; i!=size; ++i)
+    maybe_insert(i, coll, parse<typename T::value_type>(stream));
+}
+
+// whether keys are strictly increasing, i.e. can be adopted as-is by a
+// sorted-vector container
+template <class Keys, class Compare>
+bool sorted_unique(const Keys& keys, const Compare& comp)
+{
+  return std::adjacent_find(
+    keys.begin(), keys.end(),
+    [&](const auto& a, const auto& b) { return !comp(a, b); }) == keys.end();
+}
+
+// sorted-vector maps, e.g. std::flat_map, are built from their key and
+// mapped containers in one pass rather than an insert (i.e. shifting) each
+template <class T, class Stream>
+auto insert_each(Stream& stream, T& coll, typename T::size_type size, int /* preferred */)
+  -> decltype(coll.replace(std::declval<typename T::key_container_type>(),
+                           std::declval<typename T::mapped_container_type>()),
+              void())
+{
+  typename T::key_container_type keys;
+  typename T::mapped_container_type values;
+  reserve_if_applicable(keys, size);
+  reserve_if_applicable(values, size);
+  for (decltype(size) i=0; i!=size; ++i) {
+    auto kv = parse<typename T::value_type>(stream);
+    keys.push_back(std::move(kv.first));
+    values.push_back(std::move(kv.second));
+  }
+  if (BS3_LIKELY(sorted_unique(keys, coll.key_comp())))
+    coll.replace(std::move(keys), std::move(values));
+  else
+    coll = T(std::move(keys), std::move(values), coll.key_comp());
+}
+
+// sorted-vector sets, e.g. std::flat_set, likewise
+template <class T, class Stream>
+auto insert_each(Stream& stream, T& coll, typename T::size_type size, int /* preferred */)
+  -> decltype(std::declval<typename T::key_compare>(),
+              coll.replace(std::declval<typename T::container_type>()),
+              void())
+{
+  typename T::container_type keys;
+  reserve_if_applicable(keys, size);
+  for (decltype(size) i=0; i!=size; ++i)
+    keys.push_back(parse<typename T::value_type>(stream));
+  if (BS3_LIKELY(sorted_unique(keys, coll.key_comp())))
+    coll.replace(std::move(keys));
+  else
+    coll = T(std::move(keys), coll.key_comp());
+}
+
 } // namespare parse_cont_impl
 
 template <class T, class Stream>
@@ -105,9 +182,7 @@ auto parse(Stream& stream) -> decltype(
 {
   auto size = (parse<pbss::var_uint<typename T::size_type>>(stream)).v;
   typename std::remove_const<T>::type coll;
-  parse_cont_impl::reserve_if_applicable(coll, size);
-  for (decltype(size) i=0; i!=size; ++i)
-    parse_cont_impl::maybe_insert(i, coll, parse<typename T::value_type>(stream));
+  parse_cont_impl::insert_each(stream, coll, size, 0);
   return coll;
 }
 
@@ -0,0 +1,151 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSS_PROJECTION_HH
+#define BS3_PBSS_PROJECTION_HH
+
+// Parsing with a projection materializes only the listed members of
+// tagged structs, ignoring others by their stored lengths like unknown
+// tags.  It works by wrapping the stream, so the projection reaches every
+// nested struct through containers, tuples etc. with no extra plumbing.
+
+#include <ios>
+#include <type_traits>
+
+namespace pbss {
+
+// members to materialize; a tagged struct none of whose members are
+// listed is parsed in full
+template <auto... member>
+struct projection {};
+
+namespace projection_impl {
+
+template <class Stream, class Projection>
+struct projecting_reader {
+
+private:
+  Stream& stream;
+
+public:
+
+  explicit projecting_reader(Stream& s)
+    : stream(s)
+  {}
+
+  projecting_reader& read(char* dest, std::streamsize count)
+  {
+    stream.read(dest, count);
+    return *this;
+  }
+
+  bool eof() const
+  {
+    return stream.eof();
+  }
+
+  auto get()
+  {
+    return stream.get();
+  }
+
+  auto peek()
+  {
+    return stream.peek();
+  }
+
+  void ignore(std::streamsize count)
+  {
+    stream.ignore(count);
+  }
+
+  template <class S = Stream>
+  auto borrow(std::streamsize count) -> decltype(std::declval<S&>().borrow(count))
+  {
+    return stream.borrow(count);
+  }
+
+  template <class S = Stream>
+  auto lookahead(std::streamsize count) -> decltype(std::declval<S&>().lookahead(count))
+  {
+    return stream.lookahead(count);
+  }
+
+};
+
+template <class Struct, auto member>
+constexpr bool is_member_of()
+{
+  return std::is_same<
+    decltype(struct_tagged_impl::deduce_memptr_struct_type(member)),
+    Struct>::value;
+}
+
+template <auto a, auto b>
+constexpr bool is_same_member()
+{
+  return std::is_same<
+    std::integral_constant<decltype(a), a>,
+    std::integral_constant<decltype(b), b>>::value;
+}
+
+template <class Struct, auto... listed>
+constexpr bool mentions(projection<listed...>)
+{
+  return (is_member_of<Struct, listed>() || ... || false);
+}
+
+template <auto member, auto... listed>
+constexpr bool selects(projection<listed...>)
+{
+  return (is_same_member<member, listed>() || ... || false);
+}
+
+} // namespace projection_impl
+
+namespace struct_tagged_impl {
+
+template <class Stream, class Projection,
+          uint8_t id, class Struct, class Member, Member Struct::* member>
+struct parses_member<
+  projection_impl::projecting_reader<Stream, Projection>,
+  serializable_member_tag<id, Struct, Member, member>>
+  : std::integral_constant<
+      bool,
+      !projection_impl::mentions<Struct>(Projection())
+      || projection_impl::selects<member>(Projection())>
+{};
+
+} // namespace struct_tagged_impl
+
+template <class T, class Stream, auto... member>
+auto parse(Stream& stream, projection<member...>) -> decltype(
+  parse<T>(std::declval<projection_impl::projecting_reader<Stream, projection<member...>>&>()))
+{
+  projection_impl::projecting_reader<Stream, projection<member...>> reader(stream);
+  return parse<T>(reader);
+}
+
+} // namespace pbss
+
+#endif /* BS3_PBSS_PROJECTION_HH */
@@ -0,0 +1,135 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSS_RAGGED_ARRAY_IMPL_HH
+#define BS3_PBSS_RAGGED_ARRAY_IMPL_HH
+
+// ragged_array serializes as any sequence of sequences, as its rows are
+// spans.  Parsing from streams that lend out their storage first walks
+// the rows to count the values, so that values and offsets take one
+// allocation each; rows of values stored as-is are then copied as blocks.
+
+#include <cstring>
+#include <vector>
+
+#include "../ragged-array.hh"
+#include "../char-range-reader.hh"
+
+namespace pbss {
+
+namespace ragged_impl {
+
+template <class T>
+struct is_ragged_array : std::false_type {};
+
+template <class T>
+struct is_ragged_array<ragged_array<T>> : std::true_type {};
+
+template <class T, class Stream>
+void read_values(Stream& stream, std::vector<T>& values,
+                 const std::vector<std::size_t>& ends, std::true_type /* can simply read */)
+{
+  values.resize(ends.empty() ? 0 : ends.back());
+  std::size_t offset = 0;
+  for (auto end : ends) {
+    auto size = parse<pbss::var_uint<std::size_t>>(stream).v;
+    // the row has to fit where the walk put it; this also keeps the byte
+    // count from wrapping around
+    if (BS3_UNLIKELY(size != end - offset))
+      throw early_eof_error();
+    auto bytes = to_signed(size * sizeof(T));
+    auto src = stream.borrow(bytes);
+    if (BS3_UNLIKELY(!src))
+      throw early_eof_error();
+    if (bytes)
+      std::memcpy(values.data() + offset, src, to_unsigned(bytes));
+    offset = end;
+  }
+}
+
+template <class T, class Stream>
+void read_values(Stream& stream, std::vector<T>& values,
+                 const std::vector<std::size_t>& ends, std::false_type /* cannot simply read */)
+{
+  values.reserve(ends.empty() ? 0 : ends.back());
+  for (std::size_t i = 0; i != ends.size(); ++i) {
+    auto size = parse<pbss::var_uint<std::size_t>>(stream).v;
+    for (; size; --size)
+      values.push_back(parse<T>(stream));
+  }
+}
+
+template <class T, class Stream>
+auto parse_rows(Stream& stream, std::size_t rows, int /* preferred */) -> decltype(
+  stream.borrow(0),
+  T())
+{
+  using elem = typename T::element_type;
+  std::vector<std::size_t> ends(rows);
+  auto first = stream.borrow(0);
+  std::size_t total = 0;
+  for (auto& end : ends) {
+    auto size = parse<pbss::var_uint<std::size_t>>(stream).v;
+    skip_impl::skip_elems<elem>(stream, size, skip_impl::kind<elem>());
+    end = total += size;
+  }
+  auto last = stream.borrow(0);
+  if (BS3_UNLIKELY(!last))
+    throw early_eof_error();
+
+  // read again what has been walked over, so that it cannot end early
+  char_range_reader reader(first, last);
+  std::vector<elem> values;
+  read_values(reader, values, ends, is_memory_layout<elem>());
+  return T(std::move(values), std::move(ends));
+}
+
+template <class T, class Stream>
+T parse_rows(Stream& stream, std::size_t rows, long)
+{
+  using elem = typename T::element_type;
+  std::vector<std::size_t> ends(rows);
+  std::vector<elem> values;
+  for (auto& end : ends) {
+    auto size = parse<pbss::var_uint<std::size_t>>(stream).v;
+    for (; size; --size)
+      values.push_back(parse<elem>(stream));
+    end = values.size();
+  }
+  return T(std::move(values), std::move(ends));
+}
+
+} // namespace ragged_impl
+
+template <class T, class Stream>
+auto parse(Stream& stream) -> typename std::enable_if<
+  ragged_impl::is_ragged_array<typename std::remove_const<T>::type>::value,
+  T>::type
+{
+  auto rows = parse<pbss::var_uint<std::size_t>>(stream).v;
+  return ragged_impl::parse_rows<typename std::remove_const<T>::type>(stream, rows, 0);
+}
+
+} // namespace pbss
+
+#endif /* BS3_PBSS_RAGGED_ARRAY_IMPL_HH */
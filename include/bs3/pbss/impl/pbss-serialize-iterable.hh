@@ -25,6 +25,7 @@
 #define BS3_PBSS_SERIALIZE_ITERABLE_HH
 
 #include "pbss-serialize-iterable-fwd.hh"
+#include "../char-range-writer.hh"
 
 namespace pbss {
 
@@ -84,12 +85,41 @@ struct is_contiguous_container<T, decltype(std::declval<T&>().data(), void())>
   : std::true_type {};
 
 template <class T, class Stream>
-void write_elems(Stream& stream, const T& coll, std::false_type /* cannot simply copy */)
+void write_each(Stream& stream, const T& coll, long /* generic */)
 {
   for (auto&& v : coll)
     serialize(stream, v);
 }
 
+// elements of fixed size go to a region claimed from the stream at once
+template <class T, class Stream>
+auto write_each(Stream& stream, const T& coll, int /* preferred */) -> decltype(
+  stream.claim(0),
+  decltype(fixed_size(std::declval<decltype(value_type_of(coll))>(), adl_ns_tag()))::value,
+  void())
+{
+  constexpr auto size =
+    decltype(fixed_size(std::declval<decltype(value_type_of(coll))>(), adl_ns_tag()))::value;
+  char_range_writer writer(stream.claim(to_signed(size * pbss_size(coll))));
+  for (auto&& v : coll)
+    serialize(writer, v);
+}
+
+// var uints are encoded in bulk
+template <class T, class Stream>
+auto write_each(Stream& stream, const T& coll, int /* preferred */) -> typename std::enable_if<
+  vuint_impl::is_vuint<decltype(value_type_of(coll))>::value && is_contiguous_container<T>()>::type
+{
+  if (pbss_size(coll))
+    vuint_impl::write_var_uints(stream, begin_pointer_of(coll), pbss_size(coll));
+}
+
+template <class T, class Stream>
+void write_elems(Stream& stream, const T& coll, std::false_type /* cannot simply copy */)
+{
+  write_each(stream, coll, 0);
+}
+
 template <class T, class Stream>
 void write_elems(Stream& stream, const T& coll, std::true_type /* can simply copy */)
 {
@@ -143,7 +173,7 @@ auto aot_size(const T& coll, adl_ns_tag) -> decltype(
   std::size_t())
 {
   using homoseq_impl::pbss_size;
-  std::size_t s = aot_size(pbss::make_var_uint(size(coll)), adl_ns_tag());
+  std::size_t s = aot_size(pbss::make_var_uint(pbss_size(coll)), adl_ns_tag());
   for (const auto& x : coll)
     s += aot_size(x, adl_ns_tag());
   return s;
@@ -0,0 +1,195 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSS_SKIP_HH
+#define BS3_PBSS_SKIP_HH
+
+// skip<T>(stream) moves past a serialized T without materializing it.
+// Members of tagged structs are jumped over by their stored lengths, and
+// sequences of fixed size elements in one go, so the cost is roughly the
+// number of headers touched instead of the number of bytes.
+
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace pbss {
+
+template <class T, class Stream>
+void skip(Stream& stream);
+
+namespace skip_impl {
+
+struct fixed_kind {};
+struct vuint_kind {};
+struct tagged_kind {};
+struct tuple_kind {};
+struct std_tuple_kind {};
+struct sequence_kind {};
+struct other_kind {};
+
+template <int n>
+struct rank : rank<n-1> {};
+template <>
+struct rank<0> {};
+
+// tagged structs are walked by their tags even if they have fixed size:
+// data written by an older or newer version of the struct may have a
+// different set of members
+template <class T>
+auto kind_of(rank<6>) -> decltype(
+  std::declval<typename T::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME>(),
+  tagged_kind());
+
+template <class T>
+auto kind_of(rank<5>) -> decltype(
+  decltype(fixed_size(std::declval<T>(), adl_ns_tag()))::value,
+  fixed_kind());
+
+template <class T>
+auto kind_of(rank<4>)
+  -> typename std::enable_if<vuint_impl::is_vuint<T>::value, vuint_kind>::type;
+
+template <class T>
+auto kind_of(rank<3>) -> decltype(
+  std::declval<typename T::PBSS_TUPLE_MEMBER_TYPEDEF_NAME>(),
+  tuple_kind());
+
+template <class T>
+auto kind_of(rank<2>)
+  -> typename std::enable_if<stdtuple_impl::is_tuple<T>::value, std_tuple_kind>::type;
+
+// containers, spans and string views all have these
+template <class T>
+auto kind_of(rank<1>) -> decltype(
+  std::declval<typename T::size_type>(),
+  std::declval<typename T::value_type>(),
+  sequence_kind());
+
+// anything else, e.g. user-defined types with their own parse overload
+template <class T>
+other_kind kind_of(rank<0>);
+
+template <class T>
+using kind = decltype(kind_of<typename std::remove_const<T>::type>(rank<6>()));
+
+template <class T, class Stream>
+void skip_value(Stream& stream, fixed_kind)
+{
+  stream.ignore(decltype(fixed_size(std::declval<T>(), adl_ns_tag()))::value);
+}
+
+template <class T, class Stream>
+void skip_value(Stream& stream, vuint_kind)
+{
+  parse<T>(stream);
+}
+
+template <class T, class Stream>
+void skip_value(Stream& stream, tagged_kind)
+{
+  while (parse<uint8_t>(stream)) {
+    auto length = parse<pbss::var_uint<std::size_t>>(stream).v;
+    stream.ignore(to_signed(length));
+  }
+}
+
+template <class Struct, class Member, Member Struct::* member, class Stream>
+void skip_tuple_member(Stream& stream, tuple_impl::tuple_member_tag<Struct, Member, member>)
+{
+  skip<Member>(stream);
+}
+
+template <class... Tag, class Stream>
+void skip_tuple(Stream& stream, tuple_impl::tuple_members_tag<Tag...>)
+{
+  using noop = int[];
+  (void) noop {
+    0, (skip_tuple_member(stream, Tag{}), 0)...
+  };
+}
+
+template <class T, class Stream>
+void skip_value(Stream& stream, tuple_kind)
+{
+  skip_tuple(stream, typename T::PBSS_TUPLE_MEMBER_TYPEDEF_NAME());
+}
+
+template <class Tuple, size_t... i, class Stream>
+void skip_std_tuple(Stream& stream, std::index_sequence<i...>)
+{
+  using noop = int[];
+  (void) noop {
+    0, (skip<typename std::tuple_element<i, Tuple>::type>(stream), 0)...
+  };
+}
+
+template <class T, class Stream>
+void skip_value(Stream& stream, std_tuple_kind)
+{
+  skip_std_tuple<T>(stream, std::make_index_sequence<std::tuple_size<T>::value>());
+}
+
+template <class T, class Stream>
+void skip_elems(Stream& stream, std::size_t size, fixed_kind)
+{
+  constexpr auto elem_size = decltype(fixed_size(std::declval<T>(), adl_ns_tag()))::value;
+  if (BS3_UNLIKELY(size > to_unsigned(std::numeric_limits<std::streamsize>::max()) / elem_size))
+    throw early_eof_error();
+  stream.ignore(to_signed(size * elem_size));
+}
+
+template <class T, class Stream, class Kind>
+void skip_elems(Stream& stream, std::size_t size, Kind)
+{
+  for (; size; --size)
+    skip<T>(stream);
+}
+
+template <class T, class Stream>
+void skip_value(Stream& stream, sequence_kind)
+{
+  using elem = typename T::value_type;
+  auto size = parse<pbss::var_uint<std::size_t>>(stream).v;
+  skip_elems<elem>(stream, size, kind<elem>());
+}
+
+template <class T, class Stream>
+void skip_value(Stream& stream, other_kind)
+{
+  parse<T>(stream);
+}
+
+} // namespace skip_impl
+
+template <class T, class Stream>
+void skip(Stream& stream)
+{
+  skip_impl::skip_value<typename std::remove_const<T>::type>(
+    stream, skip_impl::kind<T>());
+}
+
+} // namespace pbss
+
+#endif /* BS3_PBSS_SKIP_HH */
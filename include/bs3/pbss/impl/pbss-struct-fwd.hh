@@ -31,6 +31,10 @@
 #  define PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME __pbss_tagged_object_member_tag__
 #endif
 
+#ifndef PBSS_ELIDE_DEFAULTS_TYPEDEF_NAME
+#  define PBSS_ELIDE_DEFAULTS_TYPEDEF_NAME __pbss_elide_defaults_tag__
+#endif
+
 namespace pbss {
 
 template <class T, class Stream>
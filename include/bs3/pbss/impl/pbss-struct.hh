@@ -26,6 +26,9 @@
 
 #include "pbss-struct-fwd.hh"
 #include <bs3/utils/misc.hh>
+#include <array>
+#include <cstring>
+#include <utility>
 
 namespace pbss {
 
@@ -57,6 +60,95 @@ Member deduce_memptr_member_type(Member Struct::*);
    decltype(::pbss::struct_tagged_impl::deduce_memptr_member_type(memptr)), \
    memptr>
 
+// Members may opt in to being left out when they equal their value in a
+// value-initialized struct; parsing starts from one, so readers see the
+// same value either way
+template <bool all, auto... memptr>
+struct elide_defaults_tag {};
+
+#define PBSS_ELIDE_DEFAULTS(...)                                        \
+  typedef ::pbss::struct_tagged_impl::elide_defaults_tag<false, __VA_ARGS__> \
+  PBSS_ELIDE_DEFAULTS_TYPEDEF_NAME
+
+#define PBSS_ELIDE_ALL_DEFAULTS()                                       \
+  typedef ::pbss::struct_tagged_impl::elide_defaults_tag<true>          \
+  PBSS_ELIDE_DEFAULTS_TYPEDEF_NAME
+
+template <class Struct>
+auto elide_defaults_of(int /*preferred*/) -> typename Struct::PBSS_ELIDE_DEFAULTS_TYPEDEF_NAME;
+
+template <class Struct>
+auto elide_defaults_of(long) -> elide_defaults_tag<false>;
+
+template <class Memptr>
+constexpr bool same_memptr(Memptr a, Memptr b)
+{
+  return a == b;
+}
+
+template <class A, class B>
+constexpr bool same_memptr(A, B)
+{
+  return false;
+}
+
+template <auto member, bool all, auto... memptr>
+constexpr bool elides(elide_defaults_tag<all, memptr...>)
+{
+  return all || pbsu::sumall(0, int(same_memptr(member, memptr))...) != 0;
+}
+
+template <uint8_t id, class Struct, class Member, Member Struct::* member>
+constexpr bool is_elided_member(serializable_member_tag<id, Struct, Member, member>)
+{
+  return elides<member>(decltype(elide_defaults_of<Struct>(0))());
+}
+
+template <class... Tag>
+constexpr bool has_elided_member(serialize_members_tag<Tag...>)
+{
+  return pbsu::sumall(0, int(is_elided_member(Tag()))...) != 0;
+}
+
+template <class Struct>
+const Struct& default_instance()
+{
+  static const Struct instance = Struct();
+  return instance;
+}
+
+// bytewise for memory layout members, so that e.g. -0.0 is not taken for
+// 0.0
+template <class Member>
+bool equals_default(const Member& v, const Member& d, std::true_type /* memory layout */)
+{
+  return std::memcmp(&v, &d, sizeof(Member)) == 0;
+}
+
+template <class Member>
+bool equals_default(const Member& v, const Member& d, std::false_type /* memory layout */)
+{
+  return v == d;
+}
+
+// whether a member is left out of the serialization of obj
+template <class Struct, class Member, uint8_t id, Member Struct::* member>
+typename std::enable_if<
+  !is_elided_member(serializable_member_tag<id, Struct, Member, member>()), bool>::type
+elides_member(const Struct&, serializable_member_tag<id, Struct, Member, member>)
+{
+  return false;
+}
+
+template <class Struct, class Member, uint8_t id, Member Struct::* member>
+typename std::enable_if<
+  is_elided_member(serializable_member_tag<id, Struct, Member, member>()), bool>::type
+elides_member(const Struct& obj, serializable_member_tag<id, Struct, Member, member>)
+{
+  return equals_default(obj.*member, default_instance<Struct>().*member,
+                        std::integral_constant<bool, is_memory_layout<Member>::value>());
+}
+
 template <char h, char... t>
 vuint_impl::string_constant<h, t...>
 prepend_to_strc(vuint_impl::string_constant<t...>);
@@ -86,16 +178,18 @@ auto write_field_header(Stream& stream, const T& v) -> decltype(
 
 template <uint8_t id, class Struct, class Member, Member Struct::* member, class Stream>
 auto serialize_custom_struct_member(Stream& stream, const Struct& obj,
-                                    serializable_member_tag<id, Struct, Member, member>)
+                                    serializable_member_tag<id, Struct, Member, member> tag)
   -> decltype(aot_size(obj.*member, adl_ns_tag()),
               void())
 {
+  if (elides_member(obj, tag))
+    return;
   write_field_header<id>(stream, obj.*member);
   serialize(stream, obj.*member);
 }
 
 template <class Struct, class ...Tag, class Stream>
-void serialize_custom_struct(Stream& stream, const Struct& obj, serialize_members_tag<Tag...>)
+void serialize_custom_struct_members(Stream& stream, const Struct& obj, serialize_members_tag<Tag...>)
 {
   using noop = int[];
   (void)noop {
@@ -151,13 +245,61 @@ auto skip_varuint(Stream& stream) -> decltype(
   }
 }
 
+// read in length and skip that many chars
+template <class Stream>
+void ignore_member(Stream& stream)
+{
+  auto length = parse<pbss::var_uint<size_t>>(stream).v;
+  stream.ignore(to_signed(length));
+}
+
+// whether parsing from Stream materializes a member or ignores it; only
+// projections (see pbss-projection.hh) ignore any
+template <class Stream, class Tag>
+struct parses_member : std::true_type {};
+
+template <class Struct, class Member, uint8_t type_id, Member Struct::* member, class Stream>
+void parse_member(Stream& stream, Struct& obj,
+                  serializable_member_tag<type_id, Struct, Member, member>,
+                  std::true_type /* wanted */)
+{
+  // skip var int of size
+  skip_varuint<Member>(stream);
+  // then parse the member
+  obj.*member = parse<Member>(stream);
+}
+
+// a fixed size member can be ignored blindly
+template <class Member, class Stream>
+auto ignore_member_value(Stream& stream) -> decltype(
+  decltype(fixed_size(std::declval<Member>(), adl_ns_tag()))::value,
+  void())
+{
+  skip_varuint<Member>(stream);
+  stream.ignore(decltype(fixed_size(std::declval<Member>(), adl_ns_tag()))::value);
+}
+
+template <class Member, class Stream>
+auto ignore_member_value(Stream& stream) -> decltype(
+  typename std::enable_if<has_no_fixed_size<Member>()>::type(),
+  void())
+{
+  ignore_member(stream);
+}
+
+template <class Struct, class Member, uint8_t type_id, Member Struct::* member, class Stream>
+void parse_member(Stream& stream, Struct&,
+                  serializable_member_tag<type_id, Struct, Member, member>,
+                  std::false_type /* not wanted */)
+{
+  ignore_member_value<Member>(stream);
+}
+
 template <class Struct, class Stream>
 void parse_custom_struct_member(Stream& stream, uint8_t, Struct&, serialize_members_tag<>)
 {
   // end case of unrecognized type id
-  // read in length and skip that many chars
-  auto length = parse<pbss::var_uint<size_t>>(stream).v;
-  stream.ignore(to_signed(length));
+  ignore_member(stream);
   // FIXME print a warning
 }
 
@@ -166,20 +308,84 @@ void parse_custom_struct_member(
   Stream& stream, uint8_t id, Struct& obj,
   serialize_members_tag<serializable_member_tag<type_id, Struct, Member, member>, Tag...>)
 {
-  if (id == type_id) {
-    // skip var int of size
-    skip_varuint<Member>(stream);
-    // then parse the member
-    obj.*member = parse<Member>(stream);
-  }
+  using tag = serializable_member_tag<type_id, Struct, Member, member>;
+  if (id == type_id)
+    parse_member(stream, obj, tag(), parses_member<Stream, tag>());
   else parse_custom_struct_member(stream, id, obj, serialize_members_tag<Tag...>{});
 }
 
+// large structs look the member up in a table indexed by type id, instead
+// of comparing against each tag in turn
+#ifndef PBSS_STRUCT_DISPATCH_TABLE_THRESHOLD
+#  define PBSS_STRUCT_DISPATCH_TABLE_THRESHOLD 16
+#endif
+
+template <class Struct, class Stream>
+using member_parser = void (*)(Stream&, Struct&);
+
+template <class Tag, class Struct, class Stream>
+void parse_tagged_member(Stream& stream, Struct& obj)
+{
+  parse_member(stream, obj, Tag(), parses_member<Stream, Tag>());
+}
+
+template <class Struct, class Stream>
+void ignore_unknown_member(Stream& stream, Struct&)
+{
+  ignore_member(stream);
+  // FIXME print a warning
+}
+
+template <uint8_t type_id, class Struct, class Member, Member Struct::* member>
+constexpr uint8_t member_type_id(serializable_member_tag<type_id, Struct, Member, member>)
+{
+  return type_id;
+}
+
+template <class Struct, class Stream, class... Tag>
+struct member_dispatch_table {
+
+  static constexpr std::array<member_parser<Struct, Stream>, 256> make()
+  {
+    std::array<member_parser<Struct, Stream>, 256> table {};
+    for (auto& entry : table)
+      entry = &ignore_unknown_member<Struct, Stream>;
+    // filled backwards, so that the first of duplicated ids wins, as in
+    // linear matching
+    constexpr uint8_t ids[] = { member_type_id(Tag())... };
+    constexpr member_parser<Struct, Stream> parsers[] = {
+      &parse_tagged_member<Tag, Struct, Stream>...
+    };
+    for (auto i = sizeof...(Tag); i-- > 0; )
+      table[ids[i]] = parsers[i];
+    return table;
+  }
+
+  static constexpr std::array<member_parser<Struct, Stream>, 256> table = make();
+
+};
+
+template <class Struct, class ...Tag, class Stream>
+typename std::enable_if<(sizeof...(Tag)>PBSS_STRUCT_DISPATCH_TABLE_THRESHOLD)>::type
+dispatch_custom_struct_member(
+  Stream& stream, uint8_t id, Struct& obj, serialize_members_tag<Tag...>)
+{
+  member_dispatch_table<Struct, Stream, Tag...>::table[id](stream, obj);
+}
+
+template <class Struct, class ...Tag, class Stream>
+typename std::enable_if<(sizeof...(Tag)<=PBSS_STRUCT_DISPATCH_TABLE_THRESHOLD)>::type
+dispatch_custom_struct_member(
+  Stream& stream, uint8_t id, Struct& obj, serialize_members_tag<Tag...> tag)
+{
+  parse_custom_struct_member(stream, id, obj, tag);
+}
+
 template <class Struct, class ...Tag, class Stream>
 void parse_custom_struct(Stream& stream, Struct& obj, serialize_members_tag<Tag...> tag)
 {
   while (auto id = parse<uint8_t>(stream))
-    parse_custom_struct_member(stream, id, obj, tag);
+    dispatch_custom_struct_member(stream, id, obj, tag);
 }
 
 template <class Struct, class Stream>
@@ -197,10 +403,10 @@ uint8_t parse_custom_struct_optimistic(
   Stream& stream, Struct& obj,
   serialize_members_tag<serializable_member_tag<type_id, Struct, Member, member>, Tag...>)
 {
+  using tag = serializable_member_tag<type_id, Struct, Member, member>;
   auto id = parse<uint8_t>(stream);
   if (BS3_LIKELY(id == type_id)) {
-    skip_varuint<Member>(stream);
-    obj.*member = parse<Member>(stream);
+    parse_member(stream, obj, tag(), parses_member<Stream, tag>());
     return parse_custom_struct_optimistic(stream, obj, serialize_members_tag<Tag...>{});
   } else return id;
 }
@@ -210,7 +416,7 @@ void parse_custom_struct_with_fallback(Stream& stream, Struct& obj, Tag t)
 {
   auto id = parse_custom_struct_optimistic(stream, obj, t);
   if (id == 0) return;
-  parse_custom_struct_member(stream, id, obj, t);
+  dispatch_custom_struct_member(stream, id, obj, t);
   parse_custom_struct(stream, obj, t);
 }
 
@@ -249,15 +455,20 @@ constexpr auto member_fixed_size(serializable_member_tag<id, Struct, Member, mem
     + decltype(fixed_size(std::declval<Member>(), adl_ns_tag()))::value; // itself
 }
 
+// elided members make the size vary
 template <class ...Tag>
 auto compute_fixed_size(serialize_members_tag<Tag...>)
-  -> std::integral_constant<std::size_t, sumall(member_fixed_size(Tag())...)+1>;
+  -> typename std::enable_if<
+    !has_elided_member(serialize_members_tag<Tag...>()),
+    std::integral_constant<std::size_t, sumall(member_fixed_size(Tag())...)+1>>::type;
 // +1 is trailing zero
 
 template <class Struct, uint8_t id, class Member, Member Struct::* member>
-auto member_aot_size(const Struct& obj, serializable_member_tag<id, Struct, Member, member>)
+auto member_aot_size(const Struct& obj, serializable_member_tag<id, Struct, Member, member> tag)
   -> decltype(aot_size(obj.*member, adl_ns_tag()))
 {
+  if (elides_member(obj, tag))
+    return 0;
   auto member_size = aot_size(obj.*member, adl_ns_tag());
   return 1 + aot_size(pbss::make_var_uint(member_size), adl_ns_tag()) + member_size;
 }
@@ -269,6 +480,198 @@ auto compute_aot_size(const T& obj, serialize_members_tag<Tag...>) -> decltype(
   return sumall(member_aot_size(obj, Tag())...) + 1; // +1 is trailing zero
 }
 
+// A struct with only memory layout members always serializes to the same
+// bytes besides the member values: tags, sizes and the trailing zero.  So
+// when the stream can show a whole record in place, compare it against a
+// template of those bytes built at compile time, a word at a time under a
+// mask, and copy the values in directly.  Any mismatch, e.g. from another
+// schema, falls back to parsing member by member.
+
+template <uint8_t id, class Struct, class Member, Member Struct::* member>
+constexpr bool is_layout_member(serializable_member_tag<id, Struct, Member, member>)
+{
+  // not every byte is a valid bool
+  return is_memory_layout<Member>::value && !std::is_same<Member, bool>::value;
+}
+
+template <uint8_t id, class Struct, class Member, Member Struct::* member>
+constexpr std::size_t member_value_size(serializable_member_tag<id, Struct, Member, member>)
+{
+  return decltype(fixed_size(std::declval<Member>(), adl_ns_tag()))::value;
+}
+
+template <class... Tag>
+struct layout_template {
+
+  static constexpr std::size_t size = sumall(std::size_t(1), std::size_t(member_fixed_size(Tag()))...);
+  static constexpr std::size_t words = (size+7) / 8;
+
+  struct table {
+    uint64_t bytes[words];
+    uint64_t mask[words];
+    std::size_t offset[sizeof...(Tag)];
+  };
+
+  static constexpr table make()
+  {
+    constexpr uint8_t ids[] = { member_type_id(Tag())... };
+    constexpr std::size_t sizes[] = { member_value_size(Tag())... };
+    unsigned char bytes[words*8] {};
+    unsigned char mask[words*8] {};
+    table t {};
+    std::size_t pos = 0;
+    for (std::size_t i = 0; i < sizeof...(Tag); ++i) {
+      bytes[pos] = ids[i];
+      mask[pos++] = 0xff;
+      auto n = sizes[i];
+      do {
+        bytes[pos] = static_cast<unsigned char>((n&0x7f) | (n>0x7f ? 0x80 : 0));
+        mask[pos++] = 0xff;
+      } while (n>>=7);
+      t.offset[i] = pos;
+      pos += sizes[i];
+    }
+    // trailing zero is already in bytes
+    mask[pos] = 0xff;
+    // little endian, as string_constant assumes
+    for (std::size_t i = 0; i < words*8; ++i) {
+      t.bytes[i/8] |= uint64_t(bytes[i]) << (i%8*8);
+      t.mask[i/8] |= uint64_t(mask[i]) << (i%8*8);
+    }
+    return t;
+  }
+
+  static constexpr table value = make();
+
+  static bool match(const char* p)
+  {
+    uint64_t diff = 0;
+    for (std::size_t i = 0; i < words-1; ++i) {
+      uint64_t w;
+      std::memcpy(&w, p+i*8, sizeof w);
+      diff |= (w ^ value.bytes[i]) & value.mask[i];
+    }
+    uint64_t w = 0;
+    std::memcpy(&w, p+(words-1)*8, size-(words-1)*8);
+    diff |= (w ^ value.bytes[words-1]) & value.mask[words-1];
+    return diff == 0;
+  }
+
+};
+
+template <class Struct, class Member, uint8_t type_id, Member Struct::* member>
+void copy_layout_member(const char* p, Struct& obj,
+                        serializable_member_tag<type_id, Struct, Member, member>)
+{
+  std::memcpy(&(obj.*member), p, sizeof(Member));
+}
+
+template <class Struct, class... Tag, std::size_t... i>
+void copy_layout_members(const char* p, Struct& obj, serialize_members_tag<Tag...>,
+                         std::index_sequence<i...>)
+{
+  using layout = layout_template<Tag...>;
+  using noop = int[];
+  (void) noop {
+    0, (copy_layout_member(p+layout::value.offset[i], obj, Tag()), 0)...
+  };
+}
+
+template <class... Tag>
+constexpr bool is_layout_struct(serialize_members_tag<Tag...>)
+{
+  return sizeof...(Tag) > 0
+    && sumall(0, int(is_layout_member(Tag()))...) == sizeof...(Tag)
+    // elided members leave holes in the template
+    && !has_elided_member(serialize_members_tag<Tag...>());
+}
+
+template <class Stream, class... Tag>
+constexpr bool parses_by_layout(serialize_members_tag<Tag...> tag)
+{
+  return is_layout_struct(tag)
+    // leave projections to the generic path
+    && sumall(0, int(parses_member<Stream, Tag>::value)...) == sizeof...(Tag);
+}
+
+// returns whether obj is parsed
+template <class Struct, class... Tag, class Stream>
+auto parse_custom_struct_layout(Stream& stream, Struct& obj, serialize_members_tag<Tag...> tag,
+                                int /*preferred*/) -> decltype(
+    typename std::enable_if<parses_by_layout<Stream>(serialize_members_tag<Tag...>())>::type(),
+    stream.lookahead(0),
+    bool())
+{
+  using layout = layout_template<Tag...>;
+  auto p = stream.lookahead(layout::size);
+  if (BS3_UNLIKELY(!p || !layout::match(p)))
+    return false;
+  copy_layout_members(p, obj, tag, std::index_sequence_for<Tag...>());
+  stream.ignore(layout::size);
+  return true;
+}
+
+template <class Struct, class Tag, class Stream>
+bool parse_custom_struct_layout(Stream&, Struct&, Tag, long)
+{
+  return false;
+}
+
+// serializing is the reverse: stamp the template, then fill in the values
+
+template <class Struct, class Member, uint8_t type_id, Member Struct::* member>
+void stamp_layout_member(char* p, const Struct& obj,
+                         serializable_member_tag<type_id, Struct, Member, member>)
+{
+  std::memcpy(p, &(obj.*member), sizeof(Member));
+}
+
+template <class Struct, class... Tag, std::size_t... i>
+void stamp_layout(char* p, const Struct& obj, serialize_members_tag<Tag...>,
+                  std::index_sequence<i...>)
+{
+  using layout = layout_template<Tag...>;
+  // little endian words, so bytes are in order
+  std::memcpy(p, layout::value.bytes, layout::size);
+  using noop = int[];
+  (void) noop {
+    0, (stamp_layout_member(p+layout::value.offset[i], obj, Tag()), 0)...
+  };
+}
+
+template <class Struct, class... Tag, class Stream>
+auto serialize_custom_struct_layout(Stream& stream, const Struct& obj,
+                                    serialize_members_tag<Tag...> tag,
+                                    int /*preferred*/) -> decltype(stream.claim(0), void())
+{
+  stamp_layout(stream.claim(layout_template<Tag...>::size), obj, tag,
+               std::index_sequence_for<Tag...>());
+}
+
+// for other streams stamp locally, then write in one go
+template <class Struct, class... Tag, class Stream>
+void serialize_custom_struct_layout(Stream& stream, const Struct& obj,
+                                    serialize_members_tag<Tag...> tag, long)
+{
+  char record[layout_template<Tag...>::size];
+  stamp_layout(record, obj, tag, std::index_sequence_for<Tag...>());
+  stream.write(record, sizeof record);
+}
+
+template <class Struct, class Tag, class Stream>
+typename std::enable_if<is_layout_struct(Tag())>::type
+serialize_custom_struct(Stream& stream, const Struct& obj, Tag tag)
+{
+  serialize_custom_struct_layout(stream, obj, tag, 0);
+}
+
+template <class Struct, class Tag, class Stream>
+typename std::enable_if<!is_layout_struct(Tag())>::type
+serialize_custom_struct(Stream& stream, const Struct& obj, Tag tag)
+{
+  serialize_custom_struct_members(stream, obj, tag);
+}
+
 } // namespace struct_tagged_impl
 
 template <class T, class Stream>
@@ -288,6 +691,9 @@ auto parse(Stream& stream) -> decltype(
   // https://gcc.gnu.org/bugzilla/show_bug.cgi?id=36750
   // so I am not writing type obj{};
   auto obj = typename std::remove_const<T>::type();
+  if (struct_tagged_impl::parse_custom_struct_layout(
+        stream, obj, typename T::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME(), 0))
+    return obj;
   struct_tagged_impl::parse_custom_struct_optimistic_for_large(
     stream, obj, typename T::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME());
   return obj;
@@ -0,0 +1,388 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSS_VALIDATE_HH
+#define BS3_PBSS_VALIDATE_HH
+
+// validate<T>(first, last) walks a serialized T the way parse<T> reads it,
+// without materializing anything, and tells whether parsing stays within
+// [first, last).  Stored lengths of tagged members must match what the
+// members actually take, so that parsers trusting either one read the
+// same bytes.  Input passing it can be parsed by an
+// unchecked_char_range_reader, which checks no bounds per read.
+
+#include <array>
+#include <exception>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "../char-range-reader.hh"
+
+namespace pbss {
+
+namespace validate_impl {
+
+using skip_impl::rank;
+using skip_impl::fixed_kind;
+using skip_impl::vuint_kind;
+using skip_impl::tagged_kind;
+using skip_impl::tuple_kind;
+using skip_impl::std_tuple_kind;
+using skip_impl::sequence_kind;
+using skip_impl::other_kind;
+
+// values of fixed size read as they are
+struct flat_kind {};
+
+// as in skip, tagged structs are walked by their tags even if they have
+// fixed size; unlike skip, tuples are walked by their members
+template <class T>
+auto validate_kind_of(rank<6>) -> decltype(
+  std::declval<typename T::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME>(),
+  tagged_kind());
+
+template <class T>
+auto validate_kind_of(rank<5>) -> decltype(
+  std::declval<typename T::PBSS_TUPLE_MEMBER_TYPEDEF_NAME>(),
+  tuple_kind());
+
+template <class T>
+auto validate_kind_of(rank<4>)
+  -> typename std::enable_if<stdtuple_impl::is_tuple<T>::value, std_tuple_kind>::type;
+
+template <class T>
+auto validate_kind_of(rank<3>) -> decltype(
+  decltype(fixed_size(std::declval<T>(), adl_ns_tag()))::value,
+  fixed_kind());
+
+template <class T>
+auto validate_kind_of(rank<2>)
+  -> typename std::enable_if<vuint_impl::is_vuint<T>::value, vuint_kind>::type;
+
+template <class T>
+auto validate_kind_of(rank<1>) -> decltype(
+  std::declval<typename T::size_type>(),
+  std::declval<typename T::value_type>(),
+  sequence_kind());
+
+template <class T>
+other_kind validate_kind_of(rank<0>);
+
+template <class T>
+using raw_kind = decltype(validate_kind_of<typename std::remove_const<T>::type>(rank<6>()));
+
+// tuples of values of fixed size are of fixed size themselves
+template <class T, class Kind>
+constexpr bool is_flat(Kind)
+{
+  return false;
+}
+
+template <class T>
+constexpr bool is_flat(fixed_kind)
+{
+  return true;
+}
+
+template <class Struct, class Member, Member Struct::* member>
+constexpr bool is_flat_member(tuple_impl::tuple_member_tag<Struct, Member, member>)
+{
+  return is_flat<Member>(raw_kind<Member>());
+}
+
+template <class... Tag>
+constexpr bool all_flat(tuple_impl::tuple_members_tag<Tag...>)
+{
+  return pbsu::sumall(0, int(is_flat_member(Tag()))...) == sizeof...(Tag);
+}
+
+template <class T>
+constexpr bool is_flat(tuple_kind)
+{
+  return all_flat(typename T::PBSS_TUPLE_MEMBER_TYPEDEF_NAME());
+}
+
+template <class Tuple, std::size_t... i>
+constexpr bool all_flat(std::index_sequence<i...>)
+{
+  using std::tuple_element;
+  return pbsu::sumall(
+    0, int(is_flat<typename tuple_element<i, Tuple>::type>(
+             raw_kind<typename tuple_element<i, Tuple>::type>()))...) == sizeof...(i);
+}
+
+template <class T>
+constexpr bool is_flat(std_tuple_kind)
+{
+  return all_flat<T>(std::make_index_sequence<std::tuple_size<T>::value>());
+}
+
+template <class T>
+using kind = typename std::conditional<
+  is_flat<typename std::remove_const<T>::type>(raw_kind<T>()),
+  flat_kind, raw_kind<T>>::type;
+
+template <class T>
+bool validate_value(const char*& p, const char* end);
+
+template <class T>
+constexpr std::size_t flat_size()
+{
+  return decltype(fixed_size(std::declval<T>(), adl_ns_tag()))::value;
+}
+
+template <class T>
+bool validate_value(const char*& p, const char* end, flat_kind)
+{
+  if (BS3_UNLIKELY(to_unsigned(end - p) < flat_size<T>()))
+    return false;
+  p += flat_size<T>();
+  return true;
+}
+
+// only where it ends matters for values
+template <class T>
+bool validate_value(const char*& p, const char* end, vuint_kind)
+{
+  do {
+    if (BS3_UNLIKELY(p == end))
+      return false;
+  } while (*p++ & 0x80);
+  return true;
+}
+
+// but lengths are decoded, and must fit in UInt, for parsers to agree on
+// them
+template <class UInt>
+bool read_length(const char*& p, const char* end, UInt& value)
+{
+  UInt n = 0;
+  unsigned char c;
+  unsigned offset = 0;
+  do {
+    if (BS3_UNLIKELY(p == end || offset >= std::numeric_limits<UInt>::digits))
+      return false;
+    c = static_cast<unsigned char>(*p++);
+    auto bits = UInt(c & 0x7f);
+    if (BS3_UNLIKELY(UInt(bits << offset) >> offset != bits))
+      return false;
+    n = UInt(n | UInt(bits << offset));
+    offset += 7;
+  } while (c & 0x80);
+  value = n;
+  return true;
+}
+
+// a known member of fixed size is parsed after blindly skipping as many
+// chars as its length takes when serialized by pbss
+template <class Member>
+auto header_matches(std::size_t header, int /*preferred*/) -> decltype(
+  decltype(fixed_size(std::declval<Member>(), adl_ns_tag()))::value,
+  bool())
+{
+  constexpr auto size = decltype(fixed_size(std::declval<Member>(), adl_ns_tag()))::value;
+  return header == static_size(pbss::make_var_uint(size), adl_ns_tag());
+}
+
+template <class Member>
+bool header_matches(std::size_t, long)
+{
+  return true;
+}
+
+template <uint8_t id, class Struct, class Member, Member Struct::* member>
+bool validate_member(std::size_t header, const char* first, const char* last,
+                     struct_tagged_impl::serializable_member_tag<id, Struct, Member, member>)
+{
+  return header_matches<Member>(header, 0)
+    && validate_value<Member>(first, last) && first == last;
+}
+
+// unknown members are ignored
+template <class... Tag>
+bool validate_member(uint8_t id, std::size_t header, const char* first, const char* last,
+                     struct_tagged_impl::serialize_members_tag<Tag...>)
+{
+  using struct_tagged_impl::member_type_id;
+  bool valid = true;
+  // the first of duplicated ids wins, as in parsing
+  (void) ((id == member_type_id(Tag())
+           && ((valid = validate_member(header, first, last, Tag())), true)) || ...);
+  return valid;
+}
+
+// records matching the layout template of their struct are valid as a
+// whole, as parse takes them
+template <class... Tag>
+auto match_layout(const char*& p, const char* end,
+                  struct_tagged_impl::serialize_members_tag<Tag...>)
+  -> typename std::enable_if<struct_tagged_impl::is_layout_struct(
+    struct_tagged_impl::serialize_members_tag<Tag...>()), bool>::type
+{
+  using layout = struct_tagged_impl::layout_template<Tag...>;
+  if (BS3_UNLIKELY(to_unsigned(end - p) < layout::size || !layout::match(p)))
+    return false;
+  p += layout::size;
+  return true;
+}
+
+template <class... Tag>
+auto match_layout(const char*&, const char*,
+                  struct_tagged_impl::serialize_members_tag<Tag...>)
+  -> typename std::enable_if<!struct_tagged_impl::is_layout_struct(
+    struct_tagged_impl::serialize_members_tag<Tag...>()), bool>::type
+{
+  return false;
+}
+
+template <class T>
+bool validate_value(const char*& p, const char* end, tagged_kind)
+{
+  using tag = typename T::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME;
+  if (BS3_LIKELY(match_layout(p, end, tag())))
+    return true;
+  while (true) {
+    if (BS3_UNLIKELY(p == end))
+      return false;
+    auto id = static_cast<uint8_t>(*p++);
+    if (!id)
+      return true;
+    auto header = p;
+    std::size_t length;
+    if (BS3_UNLIKELY(!read_length(p, end, length) || length > to_unsigned(end - p)))
+      return false;
+    if (BS3_UNLIKELY(!validate_member(id, to_unsigned(p - header), p, p + length, tag())))
+      return false;
+    p += length;
+  }
+}
+
+template <class Struct, class Member, Member Struct::* member>
+bool validate_tuple_member(const char*& p, const char* end,
+                           tuple_impl::tuple_member_tag<Struct, Member, member>)
+{
+  return validate_value<Member>(p, end);
+}
+
+template <class... Tag>
+bool validate_tuple(const char*& p, const char* end, tuple_impl::tuple_members_tag<Tag...>)
+{
+  return (validate_tuple_member(p, end, Tag()) && ...);
+}
+
+template <class T>
+bool validate_value(const char*& p, const char* end, tuple_kind)
+{
+  return validate_tuple(p, end, typename T::PBSS_TUPLE_MEMBER_TYPEDEF_NAME());
+}
+
+template <class Tuple, std::size_t... i>
+bool validate_std_tuple(const char*& p, const char* end, std::index_sequence<i...>)
+{
+  return (validate_value<typename std::tuple_element<i, Tuple>::type>(p, end) && ...);
+}
+
+template <class T>
+bool validate_value(const char*& p, const char* end, std_tuple_kind)
+{
+  return validate_std_tuple<T>(p, end, std::make_index_sequence<std::tuple_size<T>::value>());
+}
+
+// std::array is parsed into in place
+inline bool fits(std::size_t, const void*)
+{
+  return true;
+}
+
+template <class T, std::size_t N>
+bool fits(std::size_t size, const std::array<T, N>*)
+{
+  return size <= N;
+}
+
+template <class T>
+bool validate_elems(const char*& p, const char* end, std::size_t size, flat_kind)
+{
+  constexpr auto elem_size = flat_size<T>() ? flat_size<T>() : 1;
+  if (BS3_UNLIKELY(size > to_unsigned(end - p) / elem_size))
+    return false;
+  p += size * flat_size<T>();
+  return true;
+}
+
+template <class T, class Kind>
+bool validate_elems(const char*& p, const char* end, std::size_t size, Kind)
+{
+  // each takes at least a char, so this bounds the loop
+  if (BS3_UNLIKELY(size > to_unsigned(end - p)))
+    return false;
+  for (; size; --size)
+    if (BS3_UNLIKELY(!validate_value<T>(p, end)))
+      return false;
+  return true;
+}
+
+template <class T>
+bool validate_value(const char*& p, const char* end, sequence_kind)
+{
+  using elem = typename T::value_type;
+  typename T::size_type size;
+  if (BS3_UNLIKELY(!read_length(p, end, size) || !fits(size, static_cast<const T*>(nullptr))))
+    return false;
+  return validate_elems<elem>(p, end, size, kind<elem>());
+}
+
+// anything else, e.g. user-defined types with their own parse overload, is
+// parsed with bound checks
+template <class T>
+bool validate_value(const char*& p, const char* end, other_kind)
+{
+  char_range_reader reader(p, end);
+  try {
+    parse<T>(reader);
+  } catch (const std::exception&) {
+    return false;
+  }
+  p = reader.borrow(0);
+  return p != nullptr;
+}
+
+template <class T>
+bool validate_value(const char*& p, const char* end)
+{
+  return validate_value<typename std::remove_const<T>::type>(p, end, kind<T>());
+}
+
+} // namespace validate_impl
+
+// whether parse<T> reads only within [first, last), when starting at first
+template <class T>
+bool validate(const char* first, const char* last)
+{
+  return validate_impl::validate_value<T>(first, last);
+}
+
+} // namespace pbss
+
+#endif /* BS3_PBSS_VALIDATE_HH */
@@ -26,6 +26,8 @@
 
 #include <type_traits>
 #include <cstdint>
+#include <cstring>
+#include <bit>
 
 #include <bs3/utils/functional.hh>
 
@@ -46,7 +48,7 @@ write_var_uint(Stream& stream, UInt n)
 
 template <class UInt, class Stream>
 typename std::enable_if<std::is_unsigned<UInt>::value, UInt>::type
-read_var_uint(Stream& stream)
+read_var_uint_bytewise(Stream& stream)
 {
   UInt n = 0;
   size_t offset = 0;
@@ -61,6 +63,156 @@ read_var_uint(Stream& stream)
   return n;
 }
 
+// Word at a time coding: up to 8 encoded bytes (56 bits of value) fit in
+// a 64-bit word, where the terminating byte is found from continuation
+// bits of the whole word, and 7-bit groups are packed or spread by a few
+// masked shifts instead of a loop over bytes.
+
+constexpr uint64_t continuation_bits = 0x8080808080808080;
+
+// largest value encoded within a word
+constexpr uint64_t max_word_value = (uint64_t(1)<<56) - 1;
+
+inline uint64_t load_word(const char* p)
+{
+  uint64_t w;
+  std::memcpy(&w, p, sizeof w);
+  return w;
+}
+
+// decodes the var uint starting at the lowest byte of w into value, and
+// returns its length; 0 if it does not end within the word
+inline unsigned decode_word(uint64_t w, uint64_t& value)
+{
+  auto stops = ~w & continuation_bits;
+  if (BS3_UNLIKELY(!stops))
+    return 0;
+  // bytes up to and including the first stop; wraps to all for the 8th
+  auto x = w & (((stops & (~stops+1)) << 1) - 1) & ~continuation_bits;
+  x = ((x & 0x7f007f007f007f00) >> 1) | (x & 0x007f007f007f007f);
+  x = ((x & 0x3fff00003fff0000) >> 2) | (x & 0x00003fff00003fff);
+  x = ((x & 0x0fffffff00000000) >> 4) | (x & 0x000000000fffffff);
+  value = x;
+  return unsigned(std::countr_zero(stops)/8 + 1);
+}
+
+// encodes n <= max_word_value into w, returns its length
+inline unsigned encode_word(uint64_t n, uint64_t& w)
+{
+  auto len = unsigned(std::bit_width(n|1) + 6) / 7;
+  auto x = n;
+  x = ((x & 0x00fffffff0000000) << 4) | (x & 0x000000000fffffff);
+  x = ((x & 0x0fffc0000fffc000) << 2) | (x & 0x00003fff00003fff);
+  x = ((x & 0x3f803f803f803f80) << 1) | (x & 0x007f007f007f007f);
+  w = x | (continuation_bits & ((uint64_t(1) << (len-1)*8) - 1));
+  return len;
+}
+
+// streams that can show the next chars in place decode a word at a time
+template <class UInt, class Stream>
+auto read_var_uint(Stream& stream, int /*preferred*/) -> decltype(
+  stream.lookahead(0),
+  UInt())
+{
+  auto p = stream.lookahead(sizeof(uint64_t));
+  if (BS3_UNLIKELY(!p))
+    return read_var_uint_bytewise<UInt>(stream);
+  // the single byte case is common enough to have its own branch
+  if (BS3_LIKELY(!(*p & 0x80))) {
+    stream.ignore(1);
+    return UInt(static_cast<unsigned char>(*p));
+  }
+  uint64_t value;
+  auto len = decode_word(load_word(p), value);
+  if (BS3_UNLIKELY(!len))
+    return read_var_uint_bytewise<UInt>(stream);
+  stream.ignore(len);
+  return static_cast<UInt>(value);
+}
+
+template <class UInt, class Stream>
+UInt read_var_uint(Stream& stream, long)
+{
+  return read_var_uint_bytewise<UInt>(stream);
+}
+
+template <class UInt, class Stream>
+typename std::enable_if<std::is_unsigned<UInt>::value, UInt>::type
+read_var_uint(Stream& stream)
+{
+  return read_var_uint<UInt>(stream, 0);
+}
+
+// bulk decoding of n var uints into out, a word at a time; runs of 8
+// single byte values are taken at once
+template <class UInt, class Stream>
+auto read_var_uints(Stream& stream, pbss::var_uint<UInt>* out, std::size_t n, int /*preferred*/)
+  -> decltype(stream.lookahead(0), void())
+{
+  std::size_t i = 0;
+  while (i != n) {
+    auto p = stream.lookahead(sizeof(uint64_t));
+    if (BS3_UNLIKELY(!p))
+      break;
+    auto w = load_word(p);
+    if (!(w & continuation_bits) && n-i >= 8) {
+      for (unsigned k = 0; k != 8; ++k)
+        out[i+k].v = UInt(static_cast<unsigned char>(p[k]));
+      stream.ignore(8);
+      i += 8;
+      continue;
+    }
+    uint64_t value;
+    auto len = decode_word(w, value);
+    if (BS3_UNLIKELY(!len))
+      break;
+    out[i++].v = static_cast<UInt>(value);
+    stream.ignore(len);
+  }
+  // near the end of input, or values wider than a word
+  for (; i != n; ++i)
+    out[i].v = read_var_uint_bytewise<UInt>(stream);
+}
+
+template <class UInt, class Stream>
+void read_var_uints(Stream& stream, pbss::var_uint<UInt>* out, std::size_t n, long)
+{
+  for (std::size_t i = 0; i != n; ++i)
+    out[i].v = read_var_uint_bytewise<UInt>(stream);
+}
+
+// bulk encoding of n var uints, collected in chunks so that each is
+// written to stream at once
+template <class UInt, class Stream>
+void write_var_uints(Stream& stream, const pbss::var_uint<UInt>* in, std::size_t n)
+{
+  constexpr std::size_t chunk_values = 256;
+  // 10 bytes at most for a 64-bit value, and room to store a whole word
+  char chunk[chunk_values*10 + 8];
+  while (n) {
+    auto count = n < chunk_values ? n : chunk_values;
+    auto p = chunk;
+    for (std::size_t i = 0; i != count; ++i) {
+      uint64_t v = in[i].v;
+      if (v <= 0x7f) {
+        *p++ = char(v);
+      } else if (BS3_LIKELY(v <= max_word_value)) {
+        uint64_t w;
+        auto len = encode_word(v, w);
+        std::memcpy(p, &w, sizeof w);
+        p += len;
+      } else {
+        do {
+          *p++ = char((v&0x7f) | (v>0x7f ? 0x80 : 0));
+        } while (v>>=7);
+      }
+    }
+    stream.write(chunk, p-chunk);
+    in += count;
+    n -= count;
+  }
+}
+
 template <class T>
 struct is_vuint : std::false_type {};
 template <class UInt>
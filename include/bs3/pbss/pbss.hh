@@ -52,6 +52,15 @@ public:
   {}
 };
 
+// parse() throws this when a borrowed view would be misaligned for its
+// element type
+class unaligned_view_error : public std::runtime_error {
+public:
+  unaligned_view_error(const char* msg = "Borrowed view is not aligned")
+    : std::runtime_error(msg)
+  {}
+};
+
 // commonly used
 using pbsu::to_signed;
 using pbsu::to_unsigned;
@@ -100,6 +109,9 @@ struct is_memory_layout : std::false_type {};
 // variable length unsigned integers reference nothing
 #include "impl/pbss-var-uint.hh"
 
+// views borrowing from the input reference only memory layout elements
+#include "impl/pbss-borrowed-view.hh"
+
 // forward decls for possibly recursive types
 // std::pair<L, R> as a heterogeneous static-length sequence {L, R}
 #include "impl/pbss-std-tuple-fwd.hh"
@@ -120,6 +132,17 @@ struct is_memory_layout : std::false_type {};
 #include "impl/pbss-struct.hh"
 #include "impl/pbss-tuple.hh"
 
+// skipping over serialized values, for any type above
+#include "impl/pbss-skip.hh"
+// parsing a subset of tagged members
+#include "impl/pbss-projection.hh"
+// parsing large sequences with multiple threads
+#include "impl/pbss-parallel.hh"
+// sequences of sequences in flat storage
+#include "impl/pbss-ragged-array.hh"
+// checking input up front, to parse it without bound checks
+#include "impl/pbss-validate.hh"
+
 #include "char-range-reader.hh"
 #include "char-range-writer.hh"
 
@@ -137,7 +160,7 @@ auto serialize_to_string(const T& value)
 
 template <class T>
 auto parse_from_string(const std::string& str)
-  -> decltype(parse<T>(std::declval<std::istream&>()))
+  -> decltype(parse<T>(std::declval<char_range_reader&>()))
 {
   char_range_reader reader(&*str.begin(), (&*str.begin()) + str.size());
   return parse<T>(reader);
@@ -158,10 +181,59 @@ auto serialize_to_buffer(const T& value)
 
 template <class T>
 auto parse_from_buffer(const buffer& buf)
-  -> decltype(parse<T>(std::declval<std::istream&>()))
+  -> decltype(parse<T>(std::declval<char_range_reader&>()))
+{
+  auto beg = reinterpret_cast<const char*>(&*buf.begin());
+  char_range_reader reader(beg, beg + buf.size());
+  return parse<T>(reader);
+}
+
+// validates buf first, then parses it with no bound checks; input failing
+// validation is parsed as by parse_from_buffer, which reports the error
+template <class T>
+auto parse_from_buffer_validated(const buffer& buf)
+  -> decltype(parse<T>(std::declval<unchecked_char_range_reader&>()))
+{
+  auto beg = reinterpret_cast<const char*>(&*buf.begin());
+  if (BS3_UNLIKELY(!validate<T>(beg, beg + buf.size())))
+    return parse_from_buffer<T>(buf);
+  unchecked_char_range_reader reader(beg, beg + buf.size());
+  return parse<T>(reader);
+}
+
+template <class T, auto... member>
+auto parse_from_buffer(const buffer& buf, projection<member...> p)
+  -> decltype(parse<T>(std::declval<char_range_reader&>(), p))
 {
   auto beg = reinterpret_cast<const char*>(&*buf.begin());
   char_range_reader reader(beg, beg + buf.size());
+  return parse<T>(reader, p);
+}
+
+// serialize with up to threads threads, or as many as the hardware
+// supports if 0; see "Parallel serialization" in the documentation
+template <class T>
+auto serialize_to_buffer_parallel(const T& value, unsigned threads = 0)
+  -> decltype(serialize(std::declval<parallel_writer&>(), value),
+              buffer())
+{
+  buffer buf(aot_size(value, adl_ns_tag()));
+  auto beg = reinterpret_cast<char*>(&*buf.begin());
+  parallel_writer writer(beg, beg + buf.size(),
+                         threads ? threads : pbsu::default_concurrency());
+  serialize(writer, value);
+  return buf;
+}
+
+// parse with up to threads threads, or as many as the hardware supports if
+// 0; see "Parallel parsing" in the documentation
+template <class T>
+auto parse_from_buffer_parallel(const buffer& buf, unsigned threads = 0)
+  -> decltype(parse<T>(std::declval<parallel_reader&>()))
+{
+  auto beg = reinterpret_cast<const char*>(&*buf.begin());
+  parallel_reader reader(beg, beg + buf.size(),
+                         threads ? threads : pbsu::default_concurrency());
   return parse<T>(reader);
 }
 
@@ -0,0 +1,218 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSS_RAGGED_ARRAY_HH
+#define BS3_PBSS_RAGGED_ARRAY_HH
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace pbss {
+
+inline
+namespace ragged_abiv1 {
+
+// A sequence of rows of T, varying in length, stored as all values in one
+// vector plus the end offset of each row in another; serializes the same
+// as a sequence of sequences of T, e.g. std::vector<std::vector<T>>
+template <class T>
+class ragged_array {
+
+public:
+
+  typedef T element_type;
+  typedef std::span<const T> value_type;
+  typedef std::span<T> reference;
+  typedef std::span<const T> const_reference;
+  typedef std::size_t size_type;
+
+  class const_iterator {
+
+    const ragged_array* array;
+    size_type index;
+
+  public:
+
+    typedef std::input_iterator_tag iterator_category;
+    typedef std::random_access_iterator_tag iterator_concept;
+    typedef std::span<const T> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::span<const T> reference;
+    typedef void pointer;
+
+    const_iterator()
+      : array(nullptr), index(0)
+    {}
+
+    const_iterator(const ragged_array* a, size_type i)
+      : array(a), index(i)
+    {}
+
+    reference operator*() const
+    {
+      return (*array)[index];
+    }
+
+    const_iterator& operator++()
+    {
+      ++index;
+      return *this;
+    }
+
+    const_iterator operator++(int)
+    {
+      auto it = *this;
+      ++index;
+      return it;
+    }
+
+    bool operator==(const const_iterator& other) const
+    {
+      return index == other.index;
+    }
+
+    bool operator!=(const const_iterator& other) const
+    {
+      return index != other.index;
+    }
+
+  };
+
+  typedef const_iterator iterator;
+
+private:
+
+  std::vector<T> flat;
+  std::vector<size_type> ends;
+
+  size_type row_begin(size_type i) const
+  {
+    return i ? ends[i-1] : 0;
+  }
+
+public:
+
+  ragged_array() = default;
+
+  // from all values, and the end offset of each row in them; offsets must
+  // be ascending and not exceed the number of values
+  ragged_array(std::vector<T> values, std::vector<size_type> offsets)
+    : flat(std::move(values)), ends(std::move(offsets))
+  {}
+
+  size_type size() const
+  {
+    return ends.size();
+  }
+
+  bool empty() const
+  {
+    return ends.empty();
+  }
+
+  std::span<T> operator[](size_type i)
+  {
+    return {flat.data() + row_begin(i), ends[i] - row_begin(i)};
+  }
+
+  std::span<const T> operator[](size_type i) const
+  {
+    return {flat.data() + row_begin(i), ends[i] - row_begin(i)};
+  }
+
+  const_iterator begin() const
+  {
+    return {this, 0};
+  }
+
+  const_iterator end() const
+  {
+    return {this, size()};
+  }
+
+  // all values, row after row
+  const std::vector<T>& values() const
+  {
+    return flat;
+  }
+
+  // end offset of each row in values()
+  const std::vector<size_type>& offsets() const
+  {
+    return ends;
+  }
+
+  // add a row, copied from [first, last)
+  template <class InputIterator>
+  void append(InputIterator first, InputIterator last)
+  {
+    flat.insert(flat.end(), first, last);
+    ends.push_back(flat.size());
+  }
+
+  template <class Range>
+  void append(const Range& row)
+  {
+    using std::begin;
+    using std::end;
+    append(begin(row), end(row));
+  }
+
+  void append(std::initializer_list<T> row)
+  {
+    append(row.begin(), row.end());
+  }
+
+  void reserve(size_type rows, size_type values)
+  {
+    ends.reserve(rows);
+    flat.reserve(values);
+  }
+
+  void clear()
+  {
+    flat.clear();
+    ends.clear();
+  }
+
+  bool operator==(const ragged_array& other) const
+  {
+    return ends == other.ends && flat == other.flat;
+  }
+
+  bool operator!=(const ragged_array& other) const
+  {
+    return !(*this == other);
+  }
+
+};
+
+} // inline namespace ragged_abiv1
+
+} // namespace pbss
+
+#endif /* BS3_PBSS_RAGGED_ARRAY_HH */
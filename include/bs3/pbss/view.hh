@@ -0,0 +1,300 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_PBSS_VIEW_HH
+#define BS3_PBSS_VIEW_HH
+
+// view<T> wraps a serialized T in memory and decodes parts of it on
+// access.  Members of tagged structs are located through their stored
+// tags and lengths, and sequences are iterated lazily, so reading a few
+// fields costs roughly the headers and bytes touched instead of parsing
+// the whole tree.
+
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+#include "pbss.hh"
+
+namespace pbss {
+
+// view<T>::at<member>() throws this if the member is not in the input
+class missing_field_error : public std::out_of_range {
+public:
+  missing_field_error(const char* msg = "Tagged member not present")
+    : std::out_of_range(msg)
+  {}
+};
+
+template <class T>
+struct view;
+
+namespace view_impl {
+
+using pbss::struct_tagged_impl::serializable_member_tag;
+using pbss::struct_tagged_impl::serialize_members_tag;
+
+// find tag of a member pointer in a struct's tag list; 0 if not tagged
+template <auto member, uint8_t id, class Struct, class Member, Member Struct::* m>
+constexpr uint8_t member_id(serializable_member_tag<id, Struct, Member, m>)
+{
+  return std::is_same<
+    std::integral_constant<decltype(member), member>,
+    std::integral_constant<Member Struct::*, m>>::value ? id : 0;
+}
+
+template <auto member, class... Tag>
+constexpr uint8_t lookup_member_id(serialize_members_tag<Tag...>)
+{
+  return (member_id<member>(Tag()) | ... | 0);
+}
+
+template <class Struct, class Member>
+Member member_type_of(Member Struct::*);
+
+// tagged structs are navigated by their tags even if they have fixed size
+template <class T>
+auto view_kind_of(skip_impl::rank<2>) -> decltype(
+  std::declval<typename T::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME>(),
+  skip_impl::tagged_kind());
+
+template <class T>
+auto view_kind_of(skip_impl::rank<1>) -> typename std::enable_if<
+  std::is_same<skip_impl::kind<T>, skip_impl::sequence_kind>::value,
+  skip_impl::sequence_kind>::type;
+
+template <class T>
+void view_kind_of(skip_impl::rank<0>);
+
+template <class T>
+using kind = decltype(view_kind_of<T>(skip_impl::rank<2>()));
+
+template <class T, class Kind>
+struct view_base {
+
+  view_base(const char* first, const char* last)
+    : first(first), last(last)
+  {}
+
+  // where the serialization starts; the end is not known without
+  // scanning through it
+  const char* data() const
+  {
+    return first;
+  }
+
+  // parse the whole value; U may be any type parsing from the same
+  // serialization, e.g. a borrowed view
+  template <class U = T>
+  U get() const
+  {
+    char_range_reader reader(first, last);
+    return parse<U>(reader);
+  }
+
+protected:
+  const char* first;
+  const char* last;
+
+};
+
+template <class T>
+struct view_base<T, skip_impl::tagged_kind> : view_base<T, void> {
+
+  using view_base<T, void>::view_base;
+  using view_base<T, void>::get;
+
+  template <auto member>
+  bool has() const
+  {
+    return find<member>() != nullptr;
+  }
+
+  // view of a member; throws missing_field_error if it is absent
+  template <auto member>
+  auto at() const -> view<decltype(member_type_of(member))>
+  {
+    auto pos = find<member>();
+    if (!pos)
+      throw missing_field_error();
+    return { pos, this->last };
+  }
+
+  // value of a member; value-initialized one if absent, like parse
+  template <auto member, class U = decltype(member_type_of(member))>
+  U get() const
+  {
+    auto pos = find<member>();
+    if (!pos)
+      return T().*member;
+    char_range_reader reader(pos, this->last);
+    return parse<U>(reader);
+  }
+
+private:
+
+  template <auto member>
+  const char* find() const
+  {
+    constexpr auto id = lookup_member_id<member>(
+      typename T::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME());
+    static_assert(id, "Member is not tagged");
+    char_range_reader reader(this->first, this->last);
+    while (auto tag = parse<uint8_t>(reader)) {
+      auto length = parse<pbss::var_uint<std::size_t>>(reader).v;
+      if (tag == id)
+        return reader.borrow(0);
+      reader.ignore(to_signed(length));
+    }
+    return nullptr;
+  }
+
+};
+
+template <class T>
+struct view_base<T, skip_impl::sequence_kind> : view_base<T, void> {
+
+  using view_base<T, void>::view_base;
+  using elem_type = typename std::remove_const<typename T::value_type>::type;
+
+  struct iterator {
+
+    typedef std::forward_iterator_tag iterator_category;
+    typedef view<elem_type> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef value_type reference;
+    typedef void pointer;
+
+    iterator() = default;
+
+    iterator(const char* pos, const char* last, std::size_t remaining)
+      : pos(pos), last(last), remaining(remaining)
+    {}
+
+    reference operator*() const
+    {
+      return { pos, last };
+    }
+
+    iterator& operator++()
+    {
+      char_range_reader reader(pos, last);
+      skip<elem_type>(reader);
+      pos = reader.borrow(0);
+      if (BS3_UNLIKELY(!pos))
+        throw early_eof_error();
+      --remaining;
+      return *this;
+    }
+
+    iterator operator++(int)
+    {
+      auto copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    bool operator==(const iterator& other) const
+    {
+      return remaining == other.remaining;
+    }
+
+    bool operator!=(const iterator& other) const
+    {
+      return remaining != other.remaining;
+    }
+
+  private:
+    const char* pos = nullptr;
+    const char* last = nullptr;
+    std::size_t remaining = 0;
+
+  };
+
+  std::size_t size() const
+  {
+    char_range_reader reader(this->first, this->last);
+    return parse<pbss::var_uint<std::size_t>>(reader).v;
+  }
+
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  iterator begin() const
+  {
+    char_range_reader reader(this->first, this->last);
+    auto size = parse<pbss::var_uint<std::size_t>>(reader).v;
+    return { reader.borrow(0), this->last, size };
+  }
+
+  iterator end() const
+  {
+    return {};
+  }
+
+  // constant time for elements of fixed size, linear otherwise
+  view<elem_type> operator[](std::size_t i) const
+  {
+    return index(i, skip_impl::kind<elem_type>());
+  }
+
+private:
+
+  view<elem_type> index(std::size_t i, skip_impl::fixed_kind) const
+  {
+    constexpr auto elem_size =
+      decltype(fixed_size(std::declval<elem_type>(), adl_ns_tag()))::value;
+    char_range_reader reader(this->first, this->last);
+    parse<pbss::var_uint<std::size_t>>(reader);
+    return { reader.borrow(0) + i * elem_size, this->last };
+  }
+
+  template <class Kind>
+  view<elem_type> index(std::size_t i, Kind) const
+  {
+    return *std::next(begin(), to_signed(i));
+  }
+
+};
+
+} // namespace view_impl
+
+template <class T>
+struct view : view_impl::view_base<T, view_impl::kind<T>> {
+  using view_impl::view_base<T, view_impl::kind<T>>::view_base;
+};
+
+// a view of the T serialized at beginning of buf, valid as long as buf
+template <class T>
+view<T> make_view(const buffer& buf)
+{
+  auto beg = reinterpret_cast<const char*>(&*buf.begin());
+  return { beg, beg + buf.size() };
+}
+
+} // namespace pbss
+
+#endif /* BS3_PBSS_VIEW_HH */
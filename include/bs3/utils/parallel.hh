@@ -0,0 +1,78 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#ifndef BS3_UTILS_PARALLEL_HH
+#define BS3_UTILS_PARALLEL_HH
+
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace pbsu {
+
+// number of threads to use when not specified; at least 1
+inline unsigned default_concurrency()
+{
+  // looked up once, as it may take a system call or reading /sys
+  static const unsigned n = std::thread::hardware_concurrency();
+  return n ? n : 1;
+}
+
+// Calls fn(i) for i in [0, count), each in its own thread except the last
+// one, which runs in the calling thread, as do those for which a thread
+// cannot be started.  Returns after all are done, and rethrows the
+// exception from the lowest i if any threw.
+template <class Function>
+void run_parallel(unsigned count, Function fn)
+{
+  if (!count)
+    return;
+  std::vector<std::exception_ptr> errors(count);
+  auto run = [&](unsigned i) {
+    try {
+      fn(i);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(count-1);
+  for (unsigned i = 0; i != count-1; ++i) {
+    try {
+      threads.emplace_back(run, i);
+    } catch (const std::system_error&) {
+      run(i);
+    }
+  }
+  run(count-1);
+  for (auto& t : threads)
+    t.join();
+  for (auto& e : errors)
+    if (e)
+      std::rethrow_exception(e);
+}
+
+} // namespace pbsu
+
+#endif /* BS3_UTILS_PARALLEL_HH */
@@ -0,0 +1,67 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <bs3/pbsf/block-table.hh>
+
+namespace pbsf {
+
+inline
+namespace abiv1 {
+
+void block_table::add(int16_t type, std::streamoff offset)
+{
+  auto& t = types[type];
+  if (t.count % group == 0)
+    t.samples.push_back(offset);
+  ++t.count;
+}
+
+uint64_t block_table::count(int16_t type) const
+{
+  auto it = types.find(type);
+  return it == types.end() ? 0 : it->second.count;
+}
+
+uint64_t block_table::size() const
+{
+  uint64_t n = 0;
+  for (auto& t : types)
+    n += t.second.count;
+  return n;
+}
+
+std::pair<std::streamoff, uint64_t> block_table::locate(int16_t type, uint64_t n) const
+{
+  auto it = types.find(type);
+  if (it == types.end() || n >= it->second.count)
+    return { -1, 0 };
+  auto& samples = it->second.samples;
+  auto i = static_cast<std::size_t>(n / group);
+  if (i >= samples.size())
+    return { -1, 0 };
+  return { samples[i], n % group };
+}
+
+} // inline namespace abiv1
+
+} // namespace pbsf
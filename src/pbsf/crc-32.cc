@@ -22,28 +22,47 @@
 */
 
 #include <bs3/pbsf/crc-32.hh>
+#include <bs3/utils/parallel.hh>
+#include <algorithm>
 #include <cstddef>
+#include <vector>
 
-#ifdef __SSE4_2__
+// the least bytes worth giving a thread of its own in crc32c_parallel
+#ifndef PBSF_CRC32C_PARALLEL_MIN
+#  define PBSF_CRC32C_PARALLEL_MIN (size_t(1)<<20)
+#endif
+
+#ifdef PBSF_CRC32C_X86
 
 #include <cpuid.h>
-#include <smmintrin.h>
+#include <cstring>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+
+// The kernels are compiled for the instructions they use with target
+// attributes instead of the flags of the whole build, and only called after
+// checking the CPU, so that generic builds get them as well.
+#define PBSF_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define PBSF_TARGET_PCLMUL __attribute__((target("sse4.2,pclmul")))
 
 namespace {
 
-bool has_sse42()
+unsigned int cpuid_1_ecx()
 {
   unsigned int eax, ebx, ecx, edx;
-  __cpuid(1, eax, ebx, ecx, edx);
-  return ecx & (1<<20);
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return 0;
+  return ecx;
 }
 
+PBSF_TARGET_SSE42
 void sse_update_crc32c_8(uint32_t& acc, const char* first, const char* last)
 {
   for (; first!=last; ++first)
     acc = _mm_crc32_u8(acc, (unsigned char)*first);
 }
 
+PBSF_TARGET_SSE42
 void sse_update_crc32c_64(uint32_t& acc, const char* first, const char* last)
 {
   for (; first!=last; first+=8)
@@ -65,15 +84,8 @@ T* align_floor(T* ptr)
   return (T*)(uintptr_t(ptr) & mask);
 }
 
-} // unnamed namespace
-
-#endif /* __SSE4_2__ */
-
-namespace pbsf {
-
-#ifdef __SSE4_2__
-
-uint32_t crc32c_sse(const char* str, size_t count)
+PBSF_TARGET_SSE42
+uint32_t sse_update_crc32c(uint32_t acc, const char* str, size_t count)
 {
   const char* first = str;
   const char* last = first + count;
@@ -81,7 +93,6 @@ uint32_t crc32c_sse(const char* str, size_t count)
   const char* aligned_begin = align_ceil<8>(first);
   const char* aligned_end = align_floor<8>(last);
 
-  uint32_t acc = 0xFFFFFFFF;
   if (aligned_begin > last) {
     sse_update_crc32c_8(acc, first, last);
   } else {
@@ -89,12 +100,112 @@ uint32_t crc32c_sse(const char* str, size_t count)
     sse_update_crc32c_64(acc, aligned_begin, aligned_end);
     sse_update_crc32c_8(acc, aligned_end, last);
   }
-  return ~acc;
+  return acc;
 }
 
-#endif // __SSE4_2__
+// One crc32 instruction takes 3 cycles but a new one may start every cycle,
+// so three independent streams over three adjacent lanes run about three
+// times as fast as one.  The lanes are then merged by shifting the first
+// two past the bytes that follow them, i.e. multiplying by x^(8*n) modulo
+// the polynomial, with one carry-less multiply and one crc32 each.
 
-uint32_t crc32c_generic(const char* str, size_t count)
+// x^n mod P, bit-reflected as crc32c keeps its state
+constexpr uint32_t crc32c_xpow(size_t n)
+{
+  uint32_t v = 0x80000000;
+  for (; n; --n)
+    v = (v >> 1) ^ ((v & 1) ? 0x82f63b78 : 0);
+  return v;
+}
+
+// the multiplier shifting a crc by n bytes; pclmul of reflected operands
+// gives their product times x, and a crc32 of that over 64 bits another
+// x^32, hence the 33
+constexpr uint64_t crc32c_shift_constant(size_t n)
+{
+  return crc32c_xpow(8*n - 33);
+}
+
+PBSF_TARGET_PCLMUL
+uint32_t crc32c_shift(uint32_t crc, uint64_t constant)
+{
+  auto product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+                                      _mm_cvtsi64_si128(static_cast<long long>(constant)), 0);
+  return (uint32_t)_mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(product)));
+}
+
+inline uint64_t load_u64(const char* p)
+{
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+template <size_t lane>
+PBSF_TARGET_PCLMUL
+uint32_t pclmul_update_lanes(uint32_t crc0, const char*& str, size_t& count)
+{
+  constexpr uint64_t shift1 = crc32c_shift_constant(lane);
+  constexpr uint64_t shift2 = crc32c_shift_constant(2*lane);
+  while (count >= 3*lane) {
+    uint64_t crc1 = 0, crc2 = 0, acc0 = crc0;
+    for (const char* p = str; p != str + lane; p += 8) {
+      acc0 = _mm_crc32_u64(acc0, load_u64(p));
+      crc1 = _mm_crc32_u64(crc1, load_u64(p + lane));
+      crc2 = _mm_crc32_u64(crc2, load_u64(p + 2*lane));
+    }
+    crc0 = crc32c_shift((uint32_t)acc0, shift2)
+      ^ crc32c_shift((uint32_t)crc1, shift1) ^ (uint32_t)crc2;
+    str += 3*lane;
+    count -= 3*lane;
+  }
+  return crc0;
+}
+
+PBSF_TARGET_PCLMUL
+uint32_t pclmul_update_crc32c(uint32_t acc, const char* str, size_t count)
+{
+  // long lanes for the bulk, amortizing the merges, then short ones for
+  // what is left
+  acc = pclmul_update_lanes<8192>(acc, str, count);
+  acc = pclmul_update_lanes<256>(acc, str, count);
+  return sse_update_crc32c(acc, str, count);
+}
+
+} // unnamed namespace
+
+namespace pbsf {
+
+bool crc32c_sse_supported()
+{
+  static const bool supported = cpuid_1_ecx() & bit_SSE4_2;
+  return supported;
+}
+
+bool crc32c_pclmul_supported()
+{
+  static const bool supported =
+    (cpuid_1_ecx() & (bit_SSE4_2 | bit_PCLMUL)) == (bit_SSE4_2 | bit_PCLMUL);
+  return supported;
+}
+
+uint32_t crc32c_sse(const char* str, size_t count)
+{
+  return ~sse_update_crc32c(0xFFFFFFFF, str, count);
+}
+
+uint32_t crc32c_pclmul(const char* str, size_t count)
+{
+  return ~pclmul_update_crc32c(0xFFFFFFFF, str, count);
+}
+
+} // namespace pbsf
+
+#endif // PBSF_CRC32C_X86
+
+namespace {
+
+uint32_t generic_update_crc32c(uint32_t crc, const char* str, size_t count)
 {
   static uint32_t crc_32_tab[] = {
     0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4,
@@ -163,25 +274,115 @@ uint32_t crc32c_generic(const char* str, size_t count)
     0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351
   };
 
-  uint32_t crc = 0xFFFFFFFF;
-
   for (; count; --count, ++str)
     crc = crc_32_tab[(crc^(uint8_t)(*str)) & 0xff] ^ (crc>>8);
 
-  return ~crc;
+  return crc;
 }
 
-uint32_t crc32c(const char* str, size_t count)
+} // unnamed namespace
+
+namespace pbsf {
+
+uint32_t crc32c_generic(const char* str, size_t count)
+{
+  return ~generic_update_crc32c(0xFFFFFFFF, str, count);
+}
+
+uint32_t crc32c_extend(uint32_t crc, const char* str, size_t count)
 {
-#ifdef __SSE4_2__
+#ifdef PBSF_CRC32C_X86
 
-  static decltype(&crc32c_generic) compute = has_sse42() ? crc32c_sse : crc32c_generic;
+  static decltype(&generic_update_crc32c) update =
+    crc32c_pclmul_supported() ? pclmul_update_crc32c
+    : crc32c_sse_supported() ? sse_update_crc32c
+    : generic_update_crc32c;
 
-  return compute(str, count);
+  return ~update(~crc, str, count);
 
 #else
-  return crc32c_generic(str, count);
-#endif // __SSE4_2__
+  return ~generic_update_crc32c(~crc, str, count);
+#endif // PBSF_CRC32C_X86
+}
+
+uint32_t crc32c(const char* str, size_t count)
+{
+  return crc32c_extend(0, str, count);
+}
+
+} // namespace pbsf
+
+namespace {
+
+constexpr uint32_t crc32c_poly = 0x82f63b78;
+
+// a*b mod P, bit-reflected
+constexpr uint32_t multiply_mod(uint32_t a, uint32_t b)
+{
+  uint32_t product = 0;
+  for (uint32_t m = uint32_t(1) << 31; m; m >>= 1) {
+    if (a & m)
+      product ^= b;
+    b = (b & 1) ? (b >> 1) ^ crc32c_poly : b >> 1;
+  }
+  return product;
+}
+
+// x^(2^k) mod P for k in [0, 64)
+struct xpow2_table {
+  uint32_t entries[64] {};
+  constexpr xpow2_table()
+  {
+    entries[0] = uint32_t(1) << 30;     // x^1
+    for (int k = 1; k < 64; ++k)
+      entries[k] = multiply_mod(entries[k-1], entries[k-1]);
+  }
+};
+
+constexpr xpow2_table xpow2;
+
+// x^(8*n) mod P, i.e. the shift past n bytes
+uint32_t xpow8n(size_t n)
+{
+  uint32_t p = uint32_t(1) << 31;       // x^0
+  for (int k = 3; n; n >>= 1, ++k)
+    if (n & 1)
+      p = multiply_mod(xpow2.entries[k], p);
+  return p;
+}
+
+} // unnamed namespace
+
+namespace pbsf {
+
+// With the pre and post inversion of crc32c, crc(a+b) is
+// crc(a) * x^(8*len_b) + crc(b); the inversions cancel out.
+uint32_t crc32c_combine(uint32_t crc_a, uint32_t crc_b, size_t len_b)
+{
+  return multiply_mod(xpow8n(len_b), crc_a) ^ crc_b;
+}
+
+uint32_t crc32c_parallel(const char* str, size_t count, unsigned threads)
+{
+  if (!threads)
+    threads = pbsu::default_concurrency();
+  threads = static_cast<unsigned>(
+    std::min<size_t>(threads, std::max<size_t>(count / PBSF_CRC32C_PARALLEL_MIN, 1)));
+  if (threads == 1)
+    return crc32c(str, count);
+
+  // pieces of 64-byte multiples, so that each starts cache-aligned if the
+  // whole does; the last takes what is left
+  auto piece = (count / threads) & ~size_t(63);
+  std::vector<uint32_t> crcs(threads);
+  pbsu::run_parallel(threads, [&](unsigned i) {
+      auto len = i + 1 == threads ? count - piece * i : piece;
+      crcs[i] = crc32c(str + piece * i, len);
+    });
+  auto crc = crcs[0];
+  for (unsigned i = 1; i + 1 < threads; ++i)
+    crc = crc32c_combine(crc, crcs[i], piece);
+  return crc32c_combine(crc, crcs[threads-1], count - piece * (threads-1));
 }
 
 } // namespace pbsf
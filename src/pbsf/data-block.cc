@@ -71,12 +71,12 @@ EncodedBlock encode_block(int16_t id, pbss::buffer&& raw, int16_t encoding)
   }
 
   case PBSF_ENCODING_ZSTD: {
-    auto compressed = zstd_compress(raw);
+    uint32_t crc;
+    auto compressed = zstd_compress(raw, crc);
     if (compressed.size() > raw.size()) {
-      auto crc = crc32c(raw);
+      crc = crc32c(raw);
       return { id, PBSF_ENCODING_IDENTITY, crc, std::move(raw) };
     } else {
-      auto crc = crc32c(compressed);
       return { id, PBSF_ENCODING_ZSTD, crc, std::move(compressed) };
     }
   }
@@ -88,6 +88,23 @@ EncodedBlock encode_block(int16_t id, pbss::buffer&& raw, int16_t encoding)
 
 pbss::buffer decode_block(EncodedBlock&& block)
 {
+  // zstd checks as it goes; a bad checksum is still reported in preference
+  // to malformed data
+  if (block.contentEncoding == PBSF_ENCODING_ZSTD) {
+    uint32_t crc;
+    pbss::buffer decoded;
+    try {
+      decoded = zstd_decompress(block.content, crc);
+    } catch (const std::runtime_error&) {
+      if (block.contentChecksum != crc32c(block.content))
+        throw bad_checksum_error();
+      throw;
+    }
+    if (block.contentChecksum != crc)
+      throw bad_checksum_error();
+    return decoded;
+  }
+
   if (block.contentChecksum != crc32c(block.content))
     throw bad_checksum_error();
   switch (block.contentEncoding) {
@@ -95,8 +112,6 @@ pbss::buffer decode_block(EncodedBlock&& block)
     return std::move(block.content);
   case PBSF_ENCODING_LZO:
     return lzo_decompress(block.content);
-  case PBSF_ENCODING_ZSTD:
-    return zstd_decompress(block.content);
   default:
     throw unknown_encoding_error();
   }
@@ -0,0 +1,327 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <bs3/pbsf/file-stream.hh>
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pbsf {
+
+namespace {
+
+[[noreturn]] void throw_errno(const char* what)
+{
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+int open_flags(open_mode mode)
+{
+  switch (mode) {
+  case open_mode::overwrite:
+    return O_RDWR | O_CREAT | O_TRUNC;
+  case open_mode::update:
+    return O_RDWR | O_CREAT;
+  case open_mode::read:
+  default:
+    return O_RDONLY;
+  }
+}
+
+// reads until count chars or end of file
+std::size_t read_fully(int fd, char* dest, std::size_t count)
+{
+  std::size_t done = 0;
+  while (done < count) {
+    auto n = ::read(fd, dest + done, count - done);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      throw_errno("pbsf::file_stream read");
+    }
+    if (n == 0)
+      break;
+    done += static_cast<std::size_t>(n);
+  }
+  return done;
+}
+
+void write_fully(int fd, const char* src, std::size_t count)
+{
+  while (count) {
+    auto n = ::write(fd, src, count);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      throw_errno("pbsf::file_stream write");
+    }
+    src += n;
+    count -= static_cast<std::size_t>(n);
+  }
+}
+
+// page aligned, as the kernel copies whole pages fastest
+constexpr std::size_t buffer_alignment = 4096;
+
+} // namespace
+
+inline
+namespace abiv1 {
+
+file_stream::file_stream(const std::string& filename, open_mode mode, std::size_t buffer_size)
+  : capacity(std::max(buffer_size, std::size_t(16))),
+    buf(static_cast<char*>(std::aligned_alloc(
+          buffer_alignment,
+          (capacity + buffer_alignment - 1) / buffer_alignment * buffer_alignment)))
+{
+  if (!buf)
+    throw std::bad_alloc();
+  file = ::open(filename.c_str(), open_flags(mode) | O_CLOEXEC, 0666);
+  if (file < 0)
+    throw std::system_error(errno, std::generic_category(), filename);
+  if (mode == open_mode::read)
+    ::posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+  rcur = rend = wcur = wend = buf.get();
+}
+
+file_stream::~file_stream()
+{
+  try {
+    flush();
+  } catch (...) {
+  }
+  ::close(file);
+}
+
+file_stream& file_stream::flush()
+{
+  if (writing && wcur != buf.get()) {
+    auto count = wcur - buf.get();
+    // reset first, so that a failure does not write the same data again
+    wcur = buf.get();
+    write_fully(file, buf.get(), pbsu::to_unsigned(count));
+    base += count;
+  }
+  return *this;
+}
+
+// the file offset is kept at base while writing, and at the end of buffered
+// input while reading
+
+void file_stream::start_reading()
+{
+  if (!writing)
+    return;
+  flush();
+  writing = false;
+  rcur = rend = wcur = wend = buf.get();
+}
+
+void file_stream::start_writing()
+{
+  if (writing)
+    return;
+  auto pos = tellg();
+  if (rcur != rend) {
+    if (::lseek(file, pos, SEEK_SET) < 0)
+      throw_errno("pbsf::file_stream seek");
+  }
+  base = pos;
+  writing = true;
+  rcur = rend = buf.get();
+  wcur = buf.get();
+  wend = buf.get() + capacity;
+}
+
+std::streamsize file_stream::fill(std::streamsize count)
+{
+  start_reading();
+  auto avail = rend - rcur;
+  if (avail >= count)
+    return avail;
+  // move what is left to the front, then read as much as fits
+  auto first = buf.get();
+  std::memmove(first, rcur, pbsu::to_unsigned(avail));
+  base += rcur - first;
+  rcur = first;
+  rend = first + avail;
+  while (rend - rcur < count) {
+    auto n = read_fully(file, const_cast<char*>(rend),
+                        before_stop(base + (rend - first), pbsu::to_unsigned(first + capacity - rend)));
+    if (!n)
+      break;
+    rend += n;
+  }
+  return rend - rcur;
+}
+
+void file_stream::read_slow(char* dest, std::streamsize count)
+{
+  start_reading();
+  auto avail = rend - rcur;
+  std::memcpy(dest, rcur, pbsu::to_unsigned(avail));
+  rcur += avail;
+  dest += avail;
+  count -= avail;
+  if (pbsu::to_unsigned(count) >= capacity) {
+    // too large to go through the buffer
+    base = tellg();
+    rcur = rend = buf.get();
+    auto n = read_fully(file, dest, before_stop(base, pbsu::to_unsigned(count)));
+    base += pbsu::to_signed(n);
+    if (pbsu::to_signed(n) < count)
+      at_eof = true;
+    return;
+  }
+  auto got = std::min(fill(count), count);
+  std::memcpy(dest, rcur, pbsu::to_unsigned(got));
+  rcur += got;
+  if (got < count)
+    at_eof = true;
+}
+
+file_stream::int_type file_stream::get_slow()
+{
+  if (!fill(1)) {
+    at_eof = true;
+    return traits_type::eof();
+  }
+  return traits_type::to_int_type(*rcur++);
+}
+
+file_stream::int_type file_stream::peek_slow()
+{
+  if (!fill(1)) {
+    at_eof = true;
+    return traits_type::eof();
+  }
+  return traits_type::to_int_type(*rcur);
+}
+
+void file_stream::ignore_slow(std::streamsize count)
+{
+  start_reading();
+  auto pos = tellg() + count;
+  auto end = ::lseek(file, 0, SEEK_END);
+  if (end < 0)
+    throw_errno("pbsf::file_stream seek");
+  end = std::min(end, stop);
+  if (pos > end) {
+    at_eof = true;
+    pos = end;
+  }
+  if (::lseek(file, pos, SEEK_SET) < 0)
+    throw_errno("pbsf::file_stream seek");
+  base = pos;
+  rcur = rend = buf.get();
+}
+
+const char* file_stream::lookahead_slow(std::streamsize count)
+{
+  if (pbsu::to_unsigned(count) > capacity || fill(count) < count)
+    return nullptr;
+  return rcur;
+}
+
+void file_stream::write_slow(const char* src, std::streamsize count)
+{
+  start_writing();
+  if (count <= wend - wcur) {
+    std::memcpy(wcur, src, pbsu::to_unsigned(count));
+    wcur += count;
+    return;
+  }
+  flush();
+  if (pbsu::to_unsigned(count) >= capacity) {
+    write_fully(file, src, pbsu::to_unsigned(count));
+    base += count;
+    return;
+  }
+  std::memcpy(wcur, src, pbsu::to_unsigned(count));
+  wcur += count;
+}
+
+file_stream& file_stream::seekg(std::streamoff off, std::ios_base::seekdir dir)
+{
+  flush();
+  at_eof = false;
+  std::streamoff pos;
+  if (dir == std::ios_base::end) {
+    struct stat st;
+    if (::fstat(file, &st) < 0)
+      throw_errno("pbsf::file_stream seek");
+    pos = std::min(static_cast<std::streamoff>(st.st_size), stop) + off;
+  } else if (dir == std::ios_base::cur) {
+    pos = tellg() + off;
+  } else pos = off;
+  // within buffered input, just move there
+  if (!writing && pos >= base && pos <= base + (rend - buf.get())) {
+    rcur = buf.get() + (pos - base);
+    return *this;
+  }
+  if (::lseek(file, pos, SEEK_SET) < 0)
+    throw_errno("pbsf::file_stream seek");
+  base = pos;
+  rcur = rend = wcur = buf.get();
+  if (writing)
+    wend = buf.get() + capacity;
+  return *this;
+}
+
+void file_stream::truncate(std::streamoff size)
+{
+  flush();
+  if (::ftruncate(file, size) < 0)
+    throw_errno("pbsf::file_stream truncate");
+  // buffered input past the new end is gone
+  if (!writing && base + (rend - buf.get()) > size) {
+    auto pos = tellg();
+    if (::lseek(file, pos, SEEK_SET) < 0)
+      throw_errno("pbsf::file_stream seek");
+    base = pos;
+    rcur = rend = buf.get();
+  }
+}
+
+void file_stream::limit(std::streamoff end)
+{
+  stop = end;
+  if (!writing && base + (rend - buf.get()) > stop)
+    rend = buf.get() + std::max(stop - base, rcur - buf.get());
+}
+
+std::size_t file_stream::before_stop(std::streamoff at, std::size_t count) const
+{
+  if (at >= stop)
+    return 0;
+  return std::min(count, pbsu::to_unsigned(stop - at));
+}
+
+} // inline namespace abiv1
+
+} // namespace pbsf
@@ -0,0 +1,176 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <bs3/pbsf/follow.hh>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif // __linux__
+
+#include <bs3/pbss/pbss.hh>
+
+// most read from the file at a time
+#ifndef PBSF_FOLLOW_READ_SIZE
+#  define PBSF_FOLLOW_READ_SIZE (std::size_t(1)<<20)
+#endif
+
+namespace pbsf {
+
+namespace {
+
+constexpr std::size_t file_header_size =
+  decltype(fixed_size(FileHeader(), pbss::adl_ns_tag()))::value;
+
+[[noreturn]] void throw_errno(const char* what)
+{
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // unnamed namespace
+
+inline
+namespace abiv1 {
+
+follow_reader::follow_reader(const std::string& filename, uint32_t realm)
+  : realm(realm)
+{
+  file = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file < 0)
+    throw std::system_error(errno, std::generic_category(), filename);
+#ifdef __linux__
+  // without it, polling still works
+  notify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notify >= 0 && ::inotify_add_watch(notify, filename.c_str(), IN_MODIFY) < 0) {
+    ::close(notify);
+    notify = -1;
+  }
+#endif // __linux__
+}
+
+follow_reader::~follow_reader()
+{
+  if (notify >= 0)
+    ::close(notify);
+  ::close(file);
+}
+
+bool follow_reader::read_more()
+{
+  // drop what has been returned
+  if (buf_pos)
+    std::memmove(buf.data(), buf.data() + buf_pos, buf_end - buf_pos);
+  buf_base += static_cast<std::streamoff>(buf_pos);
+  buf_end -= buf_pos;
+  buf_pos = 0;
+  if (buf.size() < buf_end + PBSF_FOLLOW_READ_SIZE)
+    buf.resize(buf_end + PBSF_FOLLOW_READ_SIZE);
+  ssize_t n;
+  do
+    n = ::pread(file, buf.data() + buf_end, PBSF_FOLLOW_READ_SIZE,
+                buf_base + static_cast<std::streamoff>(buf_end));
+  while (n < 0 && errno == EINTR);
+  if (n < 0)
+    throw_errno("pbsf::follow_reader read");
+  buf_end += static_cast<std::size_t>(n);
+  return n > 0;
+}
+
+void follow_reader::wait(std::chrono::steady_clock::time_point deadline)
+{
+  using namespace std::chrono;
+  auto left = duration_cast<milliseconds>(deadline - steady_clock::now()).count() + 1;
+  auto ms = static_cast<int>(std::min<decltype(left)>(left, PBSF_FOLLOW_POLL_MS));
+  if (notify < 0) {
+    ::poll(nullptr, 0, ms);
+    return;
+  }
+  pollfd p { notify, POLLIN, 0 };
+  if (::poll(&p, 1, ms) > 0) {
+    char events[4096];
+    while (::read(notify, events, sizeof(events)) > 0)
+      ;
+  }
+}
+
+bool follow_reader::next(EncodedBlock& block, std::chrono::milliseconds timeout)
+{
+  using namespace std::chrono;
+  auto now = steady_clock::now();
+  auto deadline = timeout >= duration_cast<milliseconds>(steady_clock::time_point::max() - now)
+    ? steady_clock::time_point::max() : now + timeout;
+  for (;;) {
+    auto p = buf.data() + buf_pos;
+    auto avail = buf_end - buf_pos;
+    if (!header_checked && avail >= file_header_size) {
+      pbss::char_range_reader reader(p, p + file_header_size);
+      if (!(FileHeader{magic, realm} == pbss::parse<FileHeader>(reader)))
+        throw unknown_realm_error();
+      header_checked = true;
+      buf_pos += file_header_size;
+      continue;
+    }
+    if (header_checked) {
+      pbss::char_range_reader reader(p, p + avail);
+      BlockHeader header;
+      bool complete = false;
+      try {
+        header = pbss::parse<BlockHeader>(reader);
+        complete = !reader.eof();
+      } catch (const pbss::early_eof_error&) {
+      }
+      if (complete) {
+        auto header_size = static_cast<std::size_t>(aot_size(header, pbss::adl_ns_tag()));
+        auto length = static_cast<uint64_t>(header.contentLength);
+        if (avail - header_size >= length) {
+          block.contentType = header.contentType;
+          block.contentEncoding = header.contentEncoding;
+          block.contentChecksum = header.contentChecksum;
+          block.content.resize(static_cast<std::size_t>(length));
+          std::memcpy(block.content.data(), p + header_size, static_cast<std::size_t>(length));
+          block_offset = buf_base + static_cast<std::streamoff>(buf_pos);
+          buf_pos += header_size + static_cast<std::size_t>(length);
+          return true;
+        }
+      }
+    }
+    // no whole block buffered
+    if (read_more())
+      continue;
+    if (steady_clock::now() >= deadline)
+      return false;
+    wait(deadline);
+  }
+}
+
+} // inline namespace abiv1
+
+} // namespace pbsf
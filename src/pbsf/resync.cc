@@ -0,0 +1,247 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <bs3/pbsf/resync.hh>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+#include <bs3/pbsf/crc-32.hh>
+
+// bytes searched at a time for a block header
+#ifndef PBSF_RESYNC_WINDOW
+#  define PBSF_RESYNC_WINDOW (std::size_t(1)<<20)
+#endif
+
+// bytes of content checksummed in one search for candidates not followed
+// by another plausible header
+#ifndef PBSF_RESYNC_UNCONFIRMED
+#  define PBSF_RESYNC_UNCONFIRMED (std::size_t(1)<<26)
+#endif
+
+namespace pbsf {
+
+namespace {
+
+// contentType, contentEncoding, contentChecksum, and a length of 1 to 10
+// bytes
+constexpr std::size_t header_min_size = 9;
+constexpr std::size_t header_max_size = 18;
+
+bool known_encoding(int16_t encoding)
+{
+  return encoding == PBSF_ENCODING_IDENTITY
+    || encoding == PBSF_ENCODING_LZO
+    || encoding == PBSF_ENCODING_ZSTD;
+}
+
+bool plausible_encoding(const char* p)
+{
+  return p[3] == 0 && (p[2] == PBSF_ENCODING_IDENTITY
+                       || p[2] == PBSF_ENCODING_LZO
+                       || p[2] == PBSF_ENCODING_ZSTD);
+}
+
+// The first i in [from, to) where a header may start at p+i, judging by
+// its contentEncoding, a little-endian int16 at p+i+2 that must be a known
+// encoding; to if none.  Reads up to p[to+2].  Few positions pass, so
+// this filter decides the scanning speed, and is done 16 at a time.
+std::size_t next_candidate(const char* p, std::size_t from, std::size_t to)
+{
+#ifdef __SSE2__
+  const auto zero = _mm_setzero_si128();
+  const auto identity = _mm_set1_epi8(PBSF_ENCODING_IDENTITY);
+  const auto lzo = _mm_set1_epi8(PBSF_ENCODING_LZO);
+  const auto zstd = _mm_set1_epi8(PBSF_ENCODING_ZSTD);
+  for (; from + 16 <= to; from += 16) {
+    auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + from + 2));
+    auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + from + 3));
+    auto known = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(low, identity),
+                                           _mm_cmpeq_epi8(low, lzo)),
+                              _mm_cmpeq_epi8(low, zstd));
+    auto mask = _mm_movemask_epi8(_mm_and_si128(known, _mm_cmpeq_epi8(high, zero)));
+    if (mask)
+      return from + static_cast<std::size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+  }
+#endif // __SSE2__
+  for (; from != to; ++from)
+    if (plausible_encoding(p + from))
+      return from;
+  return to;
+}
+
+void read_at(int fd, char* dest, std::size_t count, std::streamoff offset)
+{
+  while (count) {
+    auto n = ::pread(fd, dest, count, offset);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::system_error(errno, std::generic_category(), "pbsf::resync_reader read");
+    }
+    if (n == 0)
+      throw std::system_error(EIO, std::generic_category(), "pbsf::resync_reader file shrank");
+    dest += n;
+    count -= static_cast<std::size_t>(n);
+    offset += n;
+  }
+}
+
+} // unnamed namespace
+
+inline
+namespace abiv1 {
+
+resync_reader::resync_reader(const std::string& filename, uint32_t realm,
+                             const int16_t* types, std::size_t ntypes)
+  : in(filename, open_mode::read)
+{
+  struct stat st;
+  if (::fstat(in.fd(), &st) < 0)
+    throw std::system_error(errno, std::generic_category(), filename);
+  size = static_cast<std::streamoff>(st.st_size);
+  if (!(FileHeader{magic, realm} == pbss::parse<FileHeader>(in)))
+    throw unknown_realm_error();
+  first = pos = in.tellg();
+  for (std::size_t i = 0; i != ntypes; ++i)
+    known_types.set(static_cast<uint16_t>(types[i]));
+}
+
+// reads the block at the given offset if it checks out; while scanning,
+// its type must be known as well
+bool resync_reader::read_block_at(std::streamoff at, EncodedBlock& block, bool scanning)
+{
+  in.seekg(at);
+  BlockHeader header;
+  try {
+    header = pbss::parse<BlockHeader>(in);
+  } catch (const std::runtime_error&) {
+    return false;
+  }
+  if (!known_encoding(header.contentEncoding))
+    return false;
+  if (scanning && !known_types[static_cast<uint16_t>(header.contentType)])
+    return false;
+  auto content = in.tellg();
+  if (header.contentLength > static_cast<uint64_t>(size - content))
+    return false;
+  auto length = static_cast<std::size_t>(header.contentLength);
+  // damage makes up lengths that would have every false candidate read
+  // and checksum most of the file.  Candidates ending where another header
+  // may start, at the end of the file, in a tail too short for a header,
+  // or before a known encoding and a type of the realm or of the
+  // library's own blocks, which are negative, are rare among false ones;
+  // the others, like a block followed by more damage, share a budget
+  if (scanning) {
+    auto end = content + static_cast<std::streamoff>(length);
+    bool confirmed = true;
+    if (size - end >= 4) {
+      char next[4];
+      read_at(in.fd(), next, sizeof next, end);
+      int16_t type;
+      std::memcpy(&type, next, sizeof(type));
+      confirmed = plausible_encoding(next)
+        && (type < 0 || known_types[static_cast<uint16_t>(type)]);
+    }
+    if (!confirmed) {
+      if (length > unconfirmed)
+        return false;
+      unconfirmed -= length;
+    }
+  }
+  block.content.resize(length);
+  in.read(reinterpret_cast<char*>(block.content.data()), static_cast<std::streamsize>(length));
+  if (in.eof() || crc32c(block.content) != header.contentChecksum)
+    return false;
+  block.contentType = header.contentType;
+  block.contentEncoding = header.contentEncoding;
+  block.contentChecksum = header.contentChecksum;
+  pos = content + static_cast<std::streamoff>(length);
+  return true;
+}
+
+// offset of the first intact block at or after from, read into block; the
+// file size if there is none
+std::streamoff resync_reader::resync(std::streamoff from, EncodedBlock& block)
+{
+  window.resize(PBSF_RESYNC_WINDOW + header_max_size);
+  unconfirmed = PBSF_RESYNC_UNCONFIRMED;
+  for (auto start = from; size - start >= static_cast<std::streamoff>(header_min_size);
+       start += PBSF_RESYNC_WINDOW) {
+    // headers starting in this window may end in the next
+    auto count = static_cast<std::size_t>(
+      std::min<std::streamoff>(static_cast<std::streamoff>(window.size()), size - start));
+    read_at(in.fd(), window.data(), count, start);
+    auto to = std::min(PBSF_RESYNC_WINDOW, count - header_min_size + 1);
+    for (auto i = next_candidate(window.data(), 0, to); i != to;
+         i = next_candidate(window.data(), i + 1, to)) {
+      int16_t type;
+      std::memcpy(&type, window.data() + i, sizeof(type));
+      if (!known_types[static_cast<uint16_t>(type)])
+        continue;
+      auto at = start + static_cast<std::streamoff>(i);
+      if (read_block_at(at, block, true))
+        return at;
+    }
+  }
+  return size;
+}
+
+std::streamoff resync_reader::seek(std::streamoff at)
+{
+  EncodedBlock block;
+  // next() reads the block found again; it is one block
+  return pos = resync(std::max(at, first), block);
+}
+
+bool resync_reader::next(EncodedBlock& block)
+{
+  if (pos >= size)
+    return false;
+  auto at = pos;
+  if (read_block_at(at, block, false)) {
+    block_offset = at;
+    return true;
+  }
+  auto found = resync(at + 1, block);
+  damage.push_back({ at, found });
+  if (found == size) {
+    pos = size;
+    return false;
+  }
+  block_offset = found;
+  return true;
+}
+
+} // inline namespace abiv1
+
+} // namespace pbsf
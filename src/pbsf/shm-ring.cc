@@ -0,0 +1,473 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <bs3/pbsf/shm-ring.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif // __linux__
+
+namespace pbsf {
+
+namespace shm_impl {
+
+// "pbsr"
+constexpr uint32_t ring_magic = 0x72736270;
+constexpr uint32_t ring_version = 1;
+
+// Frames are a length, then that many bytes, padded to 8 so lengths never
+// wrap around the end of the ring.  Positions count bytes ever written,
+// and are taken modulo the capacity.
+constexpr uint64_t length_size = sizeof(uint64_t);
+
+// a slot is free (0), being claimed (2), or held by a reader (1); the
+// writer only waits for, and only frees, slots held
+struct alignas(64) reader_slot {
+  std::atomic<uint32_t> active;
+  std::atomic<int32_t> pid;
+  // position of the next frame to read
+  std::atomic<uint64_t> tail;
+};
+
+struct ring_control {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint64_t capacity;
+  uint32_t overflow;
+  int32_t writer_pid;
+  char file_header[8];
+
+  // written by the writer
+  alignas(64) std::atomic<uint64_t> head;
+  // the first frame not overwritten, when dropping
+  std::atomic<uint64_t> oldest;
+  std::atomic<uint32_t> closed;
+
+  // bumped to wake readers waiting for data, and the writer waiting for
+  // space; the other flag is set by whoever is about to sleep, and taken
+  // by whoever wakes them, so that one wake serves all that sleep
+  alignas(64) std::atomic<uint32_t> data_seq;
+  std::atomic<uint32_t> data_sleeping;
+  alignas(64) std::atomic<uint32_t> space_seq;
+  std::atomic<uint32_t> space_sleeping;
+
+  reader_slot readers[PBSF_SHM_MAX_READERS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory needs address-free atomics");
+
+} // namespace shm_impl
+
+namespace {
+
+using namespace shm_impl;
+
+[[noreturn]] void throw_errno(const std::string& what)
+{
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+uint64_t padded(uint64_t n)
+{
+  return (n + 7) & ~uint64_t(7);
+}
+
+// sleeps until *word is no longer seen, someone wakes it, or ms pass
+void wait_on(std::atomic<uint32_t>& word, uint32_t seen, int ms)
+{
+#ifdef __linux__
+  timespec ts { ms / 1000, (ms % 1000) * 1000000L };
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, seen, &ts, nullptr, 0);
+#else
+  (void)word;
+  (void)seen;
+  ::poll(nullptr, 0, std::min(ms, 1));
+#endif // __linux__
+}
+
+void wake(std::atomic<uint32_t>& word)
+{
+  word.fetch_add(1);
+#ifdef __linux__
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif // __linux__
+}
+
+bool alive(int32_t pid)
+{
+  return ::kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// copies between the ring and a flat range, wrapping around its end
+void copy_in(char* ring, uint64_t capacity, uint64_t at, const char* src, uint64_t count)
+{
+  auto off = at & (capacity - 1);
+  auto first = std::min(count, capacity - off);
+  std::memcpy(ring + off, src, first);
+  std::memcpy(ring, src + first, count - first);
+}
+
+void copy_out(const char* ring, uint64_t capacity, uint64_t at, char* dest, uint64_t count)
+{
+  auto off = at & (capacity - 1);
+  auto first = std::min(count, capacity - off);
+  std::memcpy(dest, ring + off, first);
+  std::memcpy(dest + first, ring, count - first);
+}
+
+void* map(int fd, std::size_t size, const std::string& name)
+{
+  auto p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    auto e = errno;
+    ::close(fd);
+    errno = e;
+    throw_errno(name);
+  }
+  ::close(fd);
+  return p;
+}
+
+} // unnamed namespace
+
+inline
+namespace abiv1 {
+
+ring_writer::ring_writer(const std::string& name, uint32_t realm, ring_options options)
+  : name(name), overflow(options.overflow)
+{
+  capacity = 64;
+  while (capacity < options.capacity)
+    capacity *= 2;
+  ::shm_unlink(name.c_str());
+  int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+    throw_errno(name);
+  mapped = sizeof(ring_control) + capacity;
+  if (::ftruncate(fd, static_cast<off_t>(mapped)) < 0) {
+    auto e = errno;
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    errno = e;
+    throw_errno(name);
+  }
+  auto p = static_cast<char*>(map(fd, mapped, name));
+  ctl = new (p) ring_control;
+  data = p + sizeof(ring_control);
+  ctl->version = ring_version;
+  ctl->capacity = capacity;
+  ctl->overflow = static_cast<uint32_t>(overflow);
+  ctl->writer_pid = ::getpid();
+  auto header = pbss::serialize_to_string(FileHeader{magic, realm});
+  std::memcpy(ctl->file_header, header.data(), sizeof(ctl->file_header));
+  ctl->head = 0;
+  ctl->oldest = 0;
+  ctl->closed = 0;
+  ctl->data_seq = 0;
+  ctl->data_sleeping = 0;
+  ctl->space_seq = 0;
+  ctl->space_sleeping = 0;
+  for (auto& r : ctl->readers) {
+    r.active = 0;
+    r.tail = 0;
+  }
+  // readers wait for this
+  ctl->magic.store(ring_magic, std::memory_order_release);
+}
+
+ring_writer::~ring_writer()
+{
+  try {
+    end_block();
+  } catch (...) {
+  }
+  ctl->closed.store(1);
+  wake(ctl->data_seq);
+  ::shm_unlink(name.c_str());
+  ::munmap(ctl, mapped);
+}
+
+void ring_writer::wait_for_space(uint64_t need)
+{
+  auto head = ctl->head.load(std::memory_order_relaxed);
+  auto fits = [&] {
+    auto slowest = head;
+    for (auto& r : ctl->readers)
+      if (r.active.load() == 1)
+        slowest = std::min(slowest, r.tail.load());
+    room_until = slowest + capacity;
+    return head + need <= room_until;
+  };
+  for (;;) {
+    auto seen = ctl->space_seq.load();
+    if (fits())
+      return;
+    ctl->space_sleeping.store(1);
+    // a reader may have moved on before seeing the flag
+    if (fits())
+      return;
+    wait_on(ctl->space_seq, seen, PBSF_SHM_POLL_MS);
+    // readers gone without detaching hold no one up
+    for (auto& r : ctl->readers) {
+      uint32_t held = 1;
+      if (r.active.load() == 1 && !alive(r.pid.load()))
+        r.active.compare_exchange_strong(held, 0);
+    }
+  }
+}
+
+void ring_writer::end_block()
+{
+  if (frame.empty())
+    return;
+  auto length = static_cast<uint64_t>(frame.size());
+  auto need = length_size + padded(length);
+  if (need > capacity)
+    throw std::length_error("pbsf::ring_writer block larger than the ring");
+  auto head = ctl->head.load(std::memory_order_relaxed);
+  if (overflow == overflow_policy::block) {
+    if (head + need > room_until)
+      wait_for_space(need);
+  } else {
+    // move the oldest frame past what is about to be overwritten, before
+    // overwriting it, so readers copying it out can tell
+    auto oldest = ctl->oldest.load(std::memory_order_relaxed);
+    while (head + need - oldest > capacity) {
+      uint64_t n;
+      copy_out(data, capacity, oldest, reinterpret_cast<char*>(&n), length_size);
+      oldest += length_size + padded(n);
+    }
+    ctl->oldest.store(oldest, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  copy_in(data, capacity, head, reinterpret_cast<const char*>(&length), length_size);
+  copy_in(data, capacity, head + length_size, frame.data(), length);
+  ctl->head.store(head + need);
+  if (ctl->data_sleeping.load() && ctl->data_sleeping.exchange(0))
+    wake(ctl->data_seq);
+  written += static_cast<std::streamoff>(length);
+  frame.clear();
+}
+
+ring_reader::ring_reader(const std::string& name)
+{
+  int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0)
+    throw_errno(name);
+  // the writer may be setting it up: sizing it, then filling it in; touching
+  // the mapping before it is sized would raise SIGBUS
+  for (int i = 0; ; ++i) {
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+      auto e = errno;
+      ::close(fd);
+      errno = e;
+      throw_errno(name);
+    }
+    if (st.st_size >= static_cast<off_t>(sizeof(ring_control)))
+      break;
+    if (i == PBSF_SHM_POLL_MS) {
+      ::close(fd);
+      throw std::runtime_error("pbsf::ring_reader " + name + " is not a ring");
+    }
+    ::poll(nullptr, 0, 1);
+  }
+  auto p = static_cast<char*>(map(fd, sizeof(ring_control), name));
+  ctl = reinterpret_cast<ring_control*>(p);
+  for (int i = 0; ctl->magic.load(std::memory_order_acquire) != ring_magic; ++i) {
+    if (i == PBSF_SHM_POLL_MS) {
+      ::munmap(p, sizeof(ring_control));
+      throw std::runtime_error("pbsf::ring_reader " + name + " is not a ring");
+    }
+    ::poll(nullptr, 0, 1);
+  }
+  if (ctl->version != ring_version) {
+    ::munmap(p, sizeof(ring_control));
+    throw std::runtime_error("pbsf::ring_reader " + name + " has an unknown version");
+  }
+  capacity = ctl->capacity;
+  ::munmap(p, sizeof(ring_control));
+
+  fd = ::shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0)
+    throw_errno(name);
+  mapped = sizeof(ring_control) + capacity;
+  p = static_cast<char*>(map(fd, mapped, name));
+  ctl = reinterpret_cast<ring_control*>(p);
+  data = p + sizeof(ring_control);
+
+  for (slot = 0; slot != PBSF_SHM_MAX_READERS; ++slot) {
+    uint32_t idle = 0;
+    if (ctl->readers[slot].active.compare_exchange_strong(idle, 2))
+      break;
+  }
+  if (slot == PBSF_SHM_MAX_READERS) {
+    ::munmap(p, mapped);
+    throw std::runtime_error("pbsf::ring_reader " + name + " has too many readers");
+  }
+  auto& r = ctl->readers[slot];
+  r.pid.store(::getpid());
+  r.tail.store(ctl->head.load());
+  r.active.store(1);
+  // taken again after the writer can see the slot: the room it may have
+  // reckoned before that ends a capacity past a head no later than this
+  tail = ctl->head.load();
+  r.tail.store(tail);
+  buf.assign(ctl->file_header, ctl->file_header + sizeof(ctl->file_header));
+}
+
+ring_reader::~ring_reader()
+{
+  ctl->readers[slot].active.store(0);
+  if (ctl->space_sleeping.exchange(0))
+    wake(ctl->space_seq);
+  ::munmap(ctl, mapped);
+}
+
+bool ring_reader::next_frame()
+{
+  bool dropping = ctl->overflow == static_cast<uint32_t>(overflow_policy::drop);
+  for (;;) {
+    auto seen = ctl->data_seq.load();
+    auto head = ctl->head.load(std::memory_order_acquire);
+    if (tail == head) {
+      if (ctl->closed.load())
+        return false;
+      ctl->data_sleeping.store(1);
+      if (ctl->head.load() == tail)
+        wait_on(ctl->data_seq, seen, PBSF_SHM_POLL_MS);
+      if (ctl->head.load() == tail && !ctl->closed.load() && !alive(ctl->writer_pid))
+        return false;
+      continue;
+    }
+    if (dropping) {
+      auto oldest = ctl->oldest.load(std::memory_order_acquire);
+      if (tail < oldest) {
+        dropped_bytes += oldest - tail;
+        tail = oldest;
+        continue;
+      }
+    }
+    uint64_t length;
+    copy_out(data, capacity, tail, reinterpret_cast<char*>(&length), length_size);
+    auto had = buf.size();
+    if (length <= capacity - length_size) {
+      buf.resize(had + length);
+      copy_out(data, capacity, tail + length_size, buf.data() + had, length);
+    }
+    if (dropping) {
+      // overwritten while copying; the length too, perhaps
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (ctl->oldest.load(std::memory_order_relaxed) > tail) {
+        buf.resize(had);
+        continue;
+      }
+    }
+    tail += length_size + padded(length);
+    ctl->readers[slot].tail.store(tail, std::memory_order_release);
+    if (!dropping && ctl->space_sleeping.load() && ctl->space_sleeping.exchange(0))
+      wake(ctl->space_seq);
+    return true;
+  }
+}
+
+bool ring_reader::fill(std::size_t count)
+{
+  if (buf.size() - pos >= count)
+    return true;
+  buf.erase(buf.begin(), buf.begin() + static_cast<std::ptrdiff_t>(pos));
+  pos = 0;
+  while (buf.size() < count)
+    if (!next_frame())
+      return false;
+  return true;
+}
+
+void ring_reader::read_slow(char* dest, std::streamsize count)
+{
+  auto n = pbsu::to_unsigned(count);
+  if (!fill(n)) {
+    at_eof = true;
+    n = buf.size() - pos;
+  }
+  std::memcpy(dest, buf.data() + pos, n);
+  pos += n;
+}
+
+ring_reader::int_type ring_reader::get_slow()
+{
+  if (!fill(1)) {
+    at_eof = true;
+    return traits_type::eof();
+  }
+  return traits_type::to_int_type(buf[pos++]);
+}
+
+ring_reader::int_type ring_reader::peek_slow()
+{
+  if (!fill(1)) {
+    at_eof = true;
+    return traits_type::eof();
+  }
+  return traits_type::to_int_type(buf[pos]);
+}
+
+void ring_reader::ignore_slow(std::streamsize count)
+{
+  auto n = pbsu::to_unsigned(count);
+  if (!fill(n)) {
+    at_eof = true;
+    n = buf.size() - pos;
+  }
+  pos += n;
+}
+
+const char* ring_reader::lookahead_slow(std::streamsize count)
+{
+  if (!fill(pbsu::to_unsigned(count)))
+    return nullptr;
+  return buf.data() + pos;
+}
+
+} // inline namespace abiv1
+
+} // namespace pbsf
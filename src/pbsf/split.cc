@@ -0,0 +1,84 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <bs3/pbsf/split.hh>
+
+#include <algorithm>
+
+namespace pbsf {
+
+namespace split_impl {
+
+namespace {
+
+// the i-th of k about equal cuts of [first, last)
+std::streamoff target(std::streamoff first, std::streamoff last, std::size_t i, std::size_t k)
+{
+  auto span = pbsu::to_unsigned(last - first);
+  // without overflowing span * i
+  return first + pbsu::to_signed(span / k * i + span % k * i / k);
+}
+
+// ranges between consecutive cuts, leaving out empty ones
+std::vector<file_range> between(const std::vector<std::streamoff>& cuts)
+{
+  std::vector<file_range> ranges;
+  for (std::size_t i = 1; i < cuts.size(); ++i)
+    if (cuts[i] > cuts[i-1])
+      ranges.push_back({ cuts[i-1], cuts[i] });
+  return ranges;
+}
+
+} // unnamed namespace
+
+std::vector<file_range> split_by_table(const block_table& t, std::streamoff first,
+                                       std::size_t k)
+{
+  std::vector<std::streamoff> starts;
+  for (auto& type : t.types)
+    starts.insert(starts.end(), type.second.samples.begin(), type.second.samples.end());
+  std::sort(starts.begin(), starts.end());
+  std::vector<std::streamoff> cuts { first };
+  for (std::size_t i = 1; i < k; ++i) {
+    auto it = std::lower_bound(starts.begin(), starts.end(), target(first, t.end, i, k));
+    cuts.push_back(it == starts.end() ? t.end : *it);
+  }
+  cuts.push_back(t.end);
+  return between(cuts);
+}
+
+std::vector<file_range> split_by_resync(resync_reader& r, std::streamoff first,
+                                        std::streamoff last, std::size_t k)
+{
+  std::vector<std::streamoff> cuts { first };
+  for (std::size_t i = 1; i < k; ++i) {
+    auto at = std::max(target(first, last, i, k), cuts.back());
+    cuts.push_back(at >= last ? last : r.seek(at));
+  }
+  cuts.push_back(last);
+  return between(cuts);
+}
+
+} // namespace split_impl
+
+} // namespace pbsf
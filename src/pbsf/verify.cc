@@ -0,0 +1,206 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <bs3/pbsf/verify.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bs3/pbsf/crc-32.hh>
+#include <bs3/pbsf/data-block.hh>
+#include <bs3/pbsf/file-stream.hh>
+#include <bs3/utils/parallel.hh>
+
+// buffer for reading the headers; small, as most of the file is skipped
+#ifndef PBSF_VERIFY_SCAN_BUFFER
+#  define PBSF_VERIFY_SCAN_BUFFER (std::size_t(64)<<10)
+#endif
+
+// checksums of larger blocks are computed in pieces of this many bytes,
+// on several threads, and combined
+#ifndef PBSF_VERIFY_PIECE
+#  define PBSF_VERIFY_PIECE (std::size_t(8)<<20)
+#endif
+
+// bytes read at a time
+#ifndef PBSF_VERIFY_READ_SIZE
+#  define PBSF_VERIFY_READ_SIZE (std::size_t(1)<<20)
+#endif
+
+namespace pbsf {
+
+namespace {
+
+struct scanned_block {
+  std::streamoff offset;
+  std::streamoff content;
+  BlockHeader header;
+};
+
+// a range of one block's content checked as a unit
+struct piece {
+  std::size_t block;
+  std::streamoff offset;
+  std::size_t length;
+};
+
+void read_at(int fd, char* dest, std::size_t count, std::streamoff offset)
+{
+  while (count) {
+    auto n = ::pread(fd, dest, count, offset);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      throw std::system_error(errno, std::generic_category(), "pbsf::verify_file read");
+    }
+    if (n == 0)
+      throw std::system_error(EIO, std::generic_category(), "pbsf::verify_file file shrank");
+    dest += n;
+    count -= static_cast<std::size_t>(n);
+    offset += n;
+  }
+}
+
+} // unnamed namespace
+
+inline
+namespace abiv1 {
+
+verify_result verify_file(const std::string& filename, const verify_options& options)
+{
+  verify_result result;
+  file_stream in(filename, open_mode::read, PBSF_VERIFY_SCAN_BUFFER);
+  struct stat st;
+  if (::fstat(in.fd(), &st) < 0)
+    throw std::system_error(errno, std::generic_category(), filename);
+  auto size = static_cast<std::streamoff>(st.st_size);
+  result.bytes = static_cast<uint64_t>(size);
+
+  // find the blocks
+
+  std::vector<scanned_block> blocks;
+  std::vector<block_error> scan_errors;
+  try {
+    auto header = pbss::parse<FileHeader>(in);
+    if (header.magic != magic)
+      throw std::runtime_error("bad magic");
+    result.realm = header.realm;
+  } catch (const std::runtime_error&) {
+    result.errors.push_back({ 0, 0, "not a pbsf file" });
+    return result;
+  }
+  for (auto pos = in.tellg(); pos < size; ) {
+    BlockHeader header;
+    try {
+      header = pbss::parse<BlockHeader>(in);
+    } catch (const std::runtime_error&) {
+      scan_errors.push_back({ pos, 0, "truncated block header" });
+      break;
+    }
+    auto content = in.tellg();
+    if (header.contentLength > static_cast<uint64_t>(size - content)) {
+      scan_errors.push_back({ pos, header.contentType, "block runs past end of file" });
+      break;
+    }
+    blocks.push_back({ pos, content, header });
+    pos = content + static_cast<std::streamoff>(header.contentLength.v);
+    in.seekg(pos);
+  }
+  result.blocks = blocks.size();
+
+  // check them
+
+  std::vector<piece> pieces;
+  for (std::size_t i = 0; i != blocks.size(); ++i) {
+    auto length = static_cast<std::size_t>(blocks[i].header.contentLength);
+    auto step = options.decode ? std::max<std::size_t>(length, 1) : PBSF_VERIFY_PIECE;
+    std::size_t done = 0;
+    do {
+      auto count = std::min(step, length - done);
+      pieces.push_back({ i, blocks[i].content + static_cast<std::streamoff>(done), count });
+      done += count;
+    } while (done != length);
+  }
+
+  std::vector<uint32_t> crcs(pieces.size());
+  std::vector<std::string> decode_errors(options.decode ? blocks.size() : 0);
+  std::atomic<std::size_t> next {0};
+  auto threads = options.threads ? options.threads : pbsu::default_concurrency();
+  threads = static_cast<unsigned>(std::min<std::size_t>(threads, pieces.size()));
+  int fd = in.fd();
+  pbsu::run_parallel(threads, [&](unsigned) {
+      std::vector<char> buf(options.decode ? 0 : PBSF_VERIFY_READ_SIZE);
+      for (std::size_t i; (i = next++) < pieces.size(); ) {
+        auto& p = pieces[i];
+        if (options.decode) {
+          auto& header = blocks[p.block].header;
+          EncodedBlock block { header.contentType, header.contentEncoding,
+                               header.contentChecksum, pbss::buffer(p.length) };
+          read_at(fd, reinterpret_cast<char*>(block.content.data()), p.length, p.offset);
+          try {
+            decode_block(std::move(block));
+          } catch (const bad_checksum_error&) {
+            decode_errors[p.block] = "checksum mismatch";
+          } catch (const std::exception& e) {
+            decode_errors[p.block] = std::string("failed to decode: ") + e.what();
+          }
+          continue;
+        }
+        uint32_t crc = 0;
+        for (std::size_t done = 0; done != p.length; ) {
+          auto count = std::min(buf.size(), p.length - done);
+          read_at(fd, buf.data(), count, p.offset + static_cast<std::streamoff>(done));
+          crc = crc32c_extend(crc, buf.data(), count);
+          done += count;
+        }
+        crcs[i] = crc;
+      }
+    });
+
+  std::size_t ipiece = 0;
+  for (std::size_t i = 0; i != blocks.size(); ++i) {
+    auto& block = blocks[i];
+    if (options.decode) {
+      ++ipiece;
+      if (!decode_errors[i].empty())
+        result.errors.push_back({ block.offset, block.header.contentType, std::move(decode_errors[i]) });
+      continue;
+    }
+    auto crc = crcs[ipiece++];
+    for (; ipiece != pieces.size() && pieces[ipiece].block == i; ++ipiece)
+      crc = crc32c_combine(crc, crcs[ipiece], pieces[ipiece].length);
+    if (crc != block.header.contentChecksum)
+      result.errors.push_back({ block.offset, block.header.contentType, "checksum mismatch" });
+  }
+  result.errors.insert(result.errors.end(), scan_errors.begin(), scan_errors.end());
+  return result;
+}
+
+} // inline namespace abiv1
+
+} // namespace pbsf
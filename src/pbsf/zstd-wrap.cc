@@ -23,13 +23,41 @@
 
 #include <stdexcept>
 #include <algorithm>
+#include <memory>
 #include <string>
+#define ZSTD_STATIC_LINKING_ONLY
 #include <zstd.h>
 
+#include <bs3/pbsf/crc-32.hh>
+
 #include "zstd-wrap.hh"
 
 namespace pbsf {
 
+namespace {
+
+[[noreturn]] void throw_malformed(size_t res)
+{
+  throw std::runtime_error(std::string("Zstd decompress detected malformed data with error code ") + std::to_string(res));
+}
+
+// contexts are reused, as creating one is not cheap for small blocks
+ZSTD_CCtx* compress_context()
+{
+  thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)>
+    ctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+  return ctx.get();
+}
+
+ZSTD_DCtx* decompress_context()
+{
+  thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>
+    ctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+  return ctx.get();
+}
+
+} // unnamed namespace
+
 pbss::buffer zstd_compress(const pbss::buffer& src)
 {
 #define PBSF_ZSTD_COMPRESS_LEVEL 2
@@ -60,7 +88,87 @@ pbss::buffer zstd_decompress(const pbss::buffer& src)
     (const void *)((const char *)src.data() + sizeof(zstd_block_size_t)),
     src.size() - sizeof(zstd_block_size_t));
   if (ZSTD_isError(res))
-    throw std::runtime_error(std::string("Zstd decompress detected malformed data with error code ") + std::to_string(res));
+    throw_malformed(res);
+  return dst;
+}
+
+// Both use the buffer-less streaming API, which reads and writes the whole
+// buffers in place, so the frames are the same as from the one-shot calls.
+
+pbss::buffer zstd_compress(const pbss::buffer& src, uint32_t& crc)
+{
+  zstd_block_size_t input_size = static_cast<zstd_block_size_t>(src.size());
+  pbss::buffer dst(sizeof(zstd_block_size_t) + static_cast<unsigned>(ZSTD_compressBound(input_size)));
+  auto sizeptr = reinterpret_cast<const char*>(&input_size);
+  std::copy(sizeptr, sizeptr+sizeof(zstd_block_size_t),
+            dst.begin());
+
+  auto ctx = compress_context();
+  auto params = ZSTD_getParams(PBSF_ZSTD_COMPRESS_LEVEL, src.size(), 0);
+  params.fParams.contentSizeFlag = 1;
+  auto res = ZSTD_compressBegin_advanced(ctx, nullptr, 0, params, src.size());
+  if (ZSTD_isError(res))
+    throw std::runtime_error(std::string("Zstd compress failed with error code ") + std::to_string(res));
+
+  auto in = reinterpret_cast<const char*>(src.data());
+  auto in_end = in + src.size();
+  auto out = reinterpret_cast<char*>(dst.data());
+  auto out_end = out + dst.size();
+  crc = crc32c_extend(0, out, sizeof(zstd_block_size_t));
+  out += sizeof(zstd_block_size_t);
+  do {
+    size_t count = std::min<size_t>(in_end - in, ZSTD_BLOCKSIZE_MAX);
+    bool last = in + count == in_end;
+    res = last
+      ? ZSTD_compressEnd(ctx, out, out_end - out, in, count)
+      : ZSTD_compressContinue(ctx, out, out_end - out, in, count);
+    if (ZSTD_isError(res))
+      throw std::runtime_error(std::string("Zstd compress failed with error code ") + std::to_string(res));
+    crc = crc32c_extend(crc, out, res);
+    in += count;
+    out += res;
+  } while (in != in_end);
+
+  dst.resize(out - reinterpret_cast<char*>(dst.data()));
+  return dst;
+}
+
+pbss::buffer zstd_decompress(const pbss::buffer& src, uint32_t& crc)
+{
+  auto in = reinterpret_cast<const char*>(src.data());
+  auto in_end = in + src.size();
+  if (src.size() < sizeof(zstd_block_size_t))
+    throw std::runtime_error("Zstd decompress reached end of input early");
+
+  zstd_block_size_t out_size {};
+  std::copy(in, in+sizeof(zstd_block_size_t),
+            reinterpret_cast<char*>(&out_size));
+  crc = crc32c_extend(0, in, sizeof(zstd_block_size_t));
+  in += sizeof(zstd_block_size_t);
+
+  // the size is not covered by the checksum until the end, so it has to
+  // agree with the one in the frame header before anything is allocated
+  auto frame_size = ZSTD_getFrameContentSize(in, static_cast<size_t>(in_end - in));
+  if (out_size < 0 || frame_size != static_cast<unsigned long long>(out_size))
+    throw std::runtime_error("Zstd decompress found a wrong content size");
+
+  pbss::buffer dst(static_cast<unsigned>(out_size));
+  auto out = reinterpret_cast<char*>(dst.data());
+  auto out_end = out + dst.size();
+
+  auto ctx = decompress_context();
+  ZSTD_decompressBegin(ctx);
+  while (size_t count = ZSTD_nextSrcSizeToDecompress(ctx)) {
+    if (count > size_t(in_end - in))
+      throw std::runtime_error("Zstd decompress reached end of input early");
+    crc = crc32c_extend(crc, in, count);
+    auto res = ZSTD_decompressContinue(ctx, out, out_end - out, in, count);
+    if (ZSTD_isError(res))
+      throw_malformed(res);
+    in += count;
+    out += res;
+  }
+  crc = crc32c_extend(crc, in, in_end - in);
   return dst;
 }
 
@@ -33,6 +33,12 @@ typedef int zstd_block_size_t;
 pbss::buffer zstd_compress(const pbss::buffer&);
 pbss::buffer zstd_decompress(const pbss::buffer&);
 
+// the same, also computing crc32c of the compressed side, i.e. the output
+// of zstd_compress or the input of zstd_decompress, one zstd block at a
+// time as it is produced or consumed, instead of in a pass of its own
+pbss::buffer zstd_compress(const pbss::buffer&, uint32_t& crc);
+pbss::buffer zstd_decompress(const pbss::buffer&, uint32_t& crc);
+
 } // namespace pbsf
 
 #endif /* BS3_UTILS_ZSTD_WRAP_HH */
@@ -0,0 +1,188 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cassert>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+#include <bs3/pbsf/pbsf.hh>
+
+PBSF_DECLARE_REALM(TestRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int),
+                   PBSF_REGISTER_TYPE(4, double));
+
+const char* filename = "test-block-table-fixture";
+
+// the ints from first to last, with a double after every third
+void write_values(pbsf::sequential_file<pbsf::file_stream, TestRealm> f, int first, int last)
+{
+  auto out = f.write_iterator();
+  for (int i = first; i != last; ++i) {
+    *out++ = i;
+    if (i % 3 == 0)
+      *out++ = double(i);
+  }
+}
+
+// room for the file header and a block, but not for a footer
+struct short_buf : std::streambuf {
+  char room[32];
+  short_buf()
+  {
+    setp(room, room + sizeof room);
+  }
+};
+
+void check(int ints, bool from_footer)
+{
+  auto f = pbsf::open_sequential_input_file(filename, TestRealm());
+  assert(f.blocks().from_footer == from_footer);
+  assert(f.count<int>() == uint64_t(ints));
+  assert(f.count<double>() == uint64_t((ints + 2) / 3));
+  assert(f.blocks().size() == f.count<int>() + f.count<double>());
+
+  for (int n : { 0, 1, 255, 256, 257, 700, ints - 1 }) {
+    auto r = f.read_one_type<int>(uint64_t(n));
+    assert(r.begin() != r.end() && *r.begin() == n);
+  }
+  for (int n : { 0, 256, (ints - 1) / 3 }) {
+    auto r = f.read_one_type<double>(uint64_t(n));
+    assert(r.begin() != r.end() && *r.begin() == double(n * 3));
+  }
+  auto r = f.read_one_type<int>(uint64_t(ints));
+  assert(r.begin() == r.end());
+
+  // reading everything still works, and skips the footer
+  auto g = pbsf::open_sequential_input_file(filename, TestRealm());
+  int n = 0;
+  for (int x : g.read_one_type<int>())
+    assert(x == n++);
+  assert(n == ints);
+}
+
+int main()
+{
+
+  write_values(pbsf::open_sequential_output_file(filename, TestRealm()), 0, 1000);
+  check(1000, false);
+
+  write_values(pbsf::open_sequential_output_file(filename, TestRealm(), true, true), 0, 1000);
+  check(1000, true);
+
+  // appending replaces the footer
+  write_values(pbsf::open_sequential_output_file(filename, TestRealm(), false, true), 1000, 1500);
+  check(1500, true);
+  {
+    auto f = pbsf::open_sequential_input_file(filename, TestRealm());
+    int footers = 0;
+    for (pbsf::block_read_iterator<pbsf::file_stream> it(*f.stream_ptr), end; it != end; ++it)
+      footers += it->contentType < 0;
+    assert(footers == 2);
+  }
+
+  // appending without one leaves a stale footer, found by the scan instead
+  write_values(pbsf::open_sequential_output_file(filename, TestRealm(), false), 1500, 1600);
+  check(1600, false);
+
+  // a stale table, or damage on the way, fails the seek instead of
+  // sending it astray
+  write_values(pbsf::open_sequential_output_file(filename, TestRealm()), 0, 1000);
+  {
+    pbsf::file_stream s(filename, pbsf::open_mode::update);
+    auto t = pbsf::load_block_table(s);
+    auto where = t.locate(2, 300);
+    assert(where.first > 0 && where.second > 0);
+    s.seekp(where.first + 8);
+    s.put(char(0xff));
+    s.put(char(0xff));
+    s.put(char(0x7f));
+    s.flush();
+    s.seekg(100);
+    assert(!pbsf::seek_block(s, t, 2, 300));
+    assert(s.tellg() == 100);
+    assert(pbsf::seek_block(s, t, 2, 200));
+  }
+  write_values(pbsf::open_sequential_output_file(filename, TestRealm()), 0, 1000);
+  {
+    pbsf::file_stream s(filename, pbsf::open_mode::read);
+    auto t = pbsf::load_block_table(s);
+    assert(t.count(2) == 1000);
+    std::filesystem::resize_file(filename, 2000);
+    s.seekg(100);
+    assert(!pbsf::seek_block(s, t, 2, 400));
+    assert(s.tellg() == 100);
+  }
+
+  // written on request, reporting errors; only once
+  {
+    auto f = pbsf::open_sequential_output_file(filename, TestRealm(), true, true);
+    write_values(f, 0, 800);
+    f.finish();
+    f.finish();
+  }
+  check(800, true);
+
+  // not while unwinding
+  try {
+    auto f = pbsf::open_sequential_output_file(filename, TestRealm(), true, true);
+    write_values(f, 0, 800);
+    throw std::runtime_error("interrupted");
+  } catch (const std::runtime_error&) {
+    // good
+  }
+  check(800, false);
+
+  // errors are thrown from finish, and dropped from the destructor
+  for (bool finish : { true, false }) {
+    short_buf buf;
+    std::ostream os(&buf);
+    try {
+      auto f = pbsf::open_sequential_output_file(os, TestRealm(), true);
+      *f.write_iterator()++ = 1;
+      if (finish) {
+        f.finish();
+        assert("footer error not reported" && false);
+      }
+    } catch (const std::ios_base::failure&) {
+      assert(finish);
+    }
+  }
+
+  // and a footer written to a plain stream
+  std::stringstream ss;
+  {
+    auto f = pbsf::open_sequential_output_file(static_cast<std::ostream&>(ss), TestRealm(), true);
+    auto out = f.write_iterator();
+    for (int i = 0; i != 600; ++i)
+      *out++ = i;
+  }
+  auto f = pbsf::open_sequential_input_file(static_cast<std::istream&>(ss), TestRealm());
+  assert(f.blocks().from_footer);
+  assert(f.count<int>() == 600 && f.count<double>() == 0);
+  assert(*f.read_one_type<int>(513).begin() == 513);
+
+  return 0;
+}
@@ -31,11 +31,49 @@ int main()
 
   assert(pbsf::crc32c_generic(str.data(), str.size()) == 0x9ee6ef25);
 
-#ifdef __SSE4_2__
+#ifdef PBSF_CRC32C_X86
 
-  assert(pbsf::crc32c_sse(str.data(), str.size()) == 0x9ee6ef25);
+  if (pbsf::crc32c_sse_supported())
+    assert(pbsf::crc32c_sse(str.data(), str.size()) == 0x9ee6ef25);
 
-#endif // __SSE4_2__
+  if (pbsf::crc32c_pclmul_supported()) {
+    assert(pbsf::crc32c_pclmul(str.data(), str.size()) == 0x9ee6ef25);
+
+    // long enough for the interleaved lanes, at every length and offset
+    // around their boundaries
+    std::string big(3*8192*2 + 3*256*2 + 100, 0);
+    for (size_t i = 0; i < big.size(); ++i)
+      big[i] = static_cast<char>(i * 131 + (i >> 9));
+    for (size_t len : {size_t(767), size_t(768), size_t(769), size_t(3*8192),
+                       size_t(3*8192 + 3*256 + 7), big.size() - 8})
+      for (size_t off = 0; off < 8; ++off)
+        assert(pbsf::crc32c_pclmul(big.data() + off, len)
+               == pbsf::crc32c_generic(big.data() + off, len));
+  }
+
+#endif // PBSF_CRC32C_X86
+
+  // extending piecewise is the same as in one go
+  assert(pbsf::crc32c_extend(0, str.data(), str.size()) == 0x9ee6ef25);
+  assert(pbsf::crc32c_extend(pbsf::crc32c(str.data(), 11), str.data() + 11, 15) == 0x9ee6ef25);
+  assert(pbsf::crc32c_extend(pbsf::crc32c(str.data(), 26), str.data(), 0) == 0x9ee6ef25);
+
+  // combining crcs of the pieces
+  for (size_t split : {0, 1, 11, 25, 26})
+    assert(pbsf::crc32c_combine(pbsf::crc32c(str.data(), split),
+                                pbsf::crc32c(str.data() + split, 26 - split),
+                                26 - split) == 0x9ee6ef25);
+
+  {
+    // in parallel, with pieces that do not divide evenly
+    std::string big((5<<20) + 13, 0);
+    for (size_t i = 0; i < big.size(); ++i)
+      big[i] = static_cast<char>(i * 131 + (i >> 9));
+    auto expected = pbsf::crc32c_generic(big.data(), big.size());
+    for (unsigned threads : {0u, 1u, 2u, 3u, 7u})
+      assert(pbsf::crc32c_parallel(big.data(), big.size(), threads) == expected);
+    assert(pbsf::crc32c_parallel(str.data(), str.size(), 4) == 0x9ee6ef25);
+  }
 
   return 0;
 }
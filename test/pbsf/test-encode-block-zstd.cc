@@ -24,6 +24,7 @@
 #include <random>
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <bs3/pbsf/pbsf.hh>
 
 int main()
@@ -63,6 +64,32 @@ int main()
            && block.content.size() < s.size());
     assert("decoded block should match original data"
            && decode_block(EncodedBlock(block)) == s);
+
+    // corrupt content is reported as such, before it fails to decompress
+    for (size_t pos : {size_t(0), size_t(6), block.content.size() - 1}) {
+      auto bad = block;
+      bad.content[pos] = static_cast<char>(bad.content[pos] ^ 0x5a);
+      try {
+        decode_block(std::move(bad));
+        assert("bad checksum not reported" && false);
+      } catch (const pbsf::bad_checksum_error&) {
+        // good
+      }
+    }
+
+    // so is a corrupt size, without decompressing into what it claims
+    for (size_t pos : {size_t(2), size_t(3)}) {
+      auto bad = block;
+      bad.content[pos] = static_cast<char>(bad.content[pos] ^ 0x5a);
+      auto start = std::chrono::steady_clock::now();
+      try {
+        decode_block(std::move(bad));
+        assert("bad checksum not reported" && false);
+      } catch (const pbsf::bad_checksum_error&) {
+        // good
+      }
+      assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    }
   }
 
   return 0;
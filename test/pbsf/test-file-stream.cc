@@ -0,0 +1,140 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cassert>
+#include <string>
+#include <system_error>
+
+#include <bs3/pbsf/pbsf.hh>
+#include <bs3/pbss/pbss.hh>
+
+int main()
+{
+
+  const char* filename = "test-file-stream-fixture";
+  using pbsf::file_stream;
+  using pbsf::open_mode;
+  using traits = std::char_traits<char>;
+
+  std::string data;
+  for (int i = 0; i < 1000; ++i)
+    data += static_cast<char>(i * 7);
+
+  {
+    // write and read back, through a buffer smaller than the data
+    {
+      file_stream out(filename, open_mode::overwrite, 64);
+      out.write(data.data(), 100);
+      for (std::size_t i = 100; i < 200; ++i)
+        out.put(data[i]);
+      out.write(data.data() + 200, 800);
+      assert(out.tellp() == 1000);
+    }
+    file_stream in(filename, open_mode::read, 64);
+    std::string back(1000, 0);
+    in.read(&back[0], 10);
+    assert(in.peek() == traits::to_int_type(data[10]));
+    assert(in.get() == traits::to_int_type(data[10]));
+    in.read(&back[11], 989);
+    back[10] = data[10];
+    assert(back == data);
+    assert(!in.eof());
+    assert(in.tellg() == 1000);
+    assert(in.peek() == traits::eof());
+    assert(in.eof());
+  }
+
+  {
+    // short read sets eof
+    file_stream in(filename, open_mode::read, 64);
+    std::string back(2000, 0);
+    in.read(&back[0], 2000);
+    assert(in.eof());
+  }
+
+  {
+    // ignore and lookahead
+    file_stream in(filename, open_mode::read, 64);
+    in.ignore(500);
+    assert(in.tellg() == 500);
+    auto p = in.lookahead(50);
+    assert(p && std::string(p, 50) == data.substr(500, 50));
+    assert(in.tellg() == 500);
+    // larger than the buffer
+    assert(!in.lookahead(100));
+    in.ignore(480);
+    assert(!in.lookahead(30));
+    assert(!in.eof());
+    in.ignore(30);
+    assert(in.eof());
+  }
+
+  {
+    // seeking, and switching between reading and writing
+    {
+      file_stream f(filename, open_mode::update, 64);
+      f.seekg(-10, std::ios_base::end);
+      assert(f.tellg() == 990);
+      assert(f.get() == traits::to_int_type(data[990]));
+      f.seekg(3);
+      assert(f.get() == traits::to_int_type(data[3]));
+      f.write("abc", 3);
+      assert(f.tellg() == 7);
+      assert(f.get() == traits::to_int_type(data[7]));
+      f.seekp(0, std::ios_base::end);
+      f.write("xyz", 3);
+      f.seekg(-4, std::ios_base::cur);
+      assert(f.get() == traits::to_int_type(data[999]));
+      assert(f.get() == 'x');
+    }
+    data.replace(4, 3, "abc");
+    data += "xyz";
+    file_stream in(filename, open_mode::read);
+    std::string back(1003, 0);
+    in.read(&back[0], 1003);
+    assert(back == data);
+  }
+
+  {
+    // pbss parses and serializes through it
+    std::vector<std::string> v { "hello", "world", std::string(300, 'x') };
+    {
+      file_stream out(filename, open_mode::overwrite, 64);
+      pbss::serialize(out, v);
+    }
+    file_stream in(filename, open_mode::read, 64);
+    assert(pbss::parse<std::vector<std::string>>(in) == v);
+  }
+
+  {
+    // failure to open throws
+    try {
+      file_stream in("test-file-stream-file-should-not-exist");
+      assert("failure to open not reported" && false);
+    } catch (const std::system_error&) {
+      // good
+    }
+  }
+
+  return 0;
+}
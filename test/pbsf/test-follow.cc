@@ -0,0 +1,101 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <bs3/pbsf/pbsf.hh>
+#include <bs3/pbsf/follow.hh>
+
+PBSF_DECLARE_REALM(TestRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int),
+                   PBSF_REGISTER_TYPE(4, std::string));
+
+PBSF_DECLARE_REALM(OtherRealm, 43,
+                   PBSF_REGISTER_TYPE(2, int));
+
+const char* filename = "test-follow-fixture";
+
+using namespace std::chrono_literals;
+
+// writes the file a few bytes at a time, so the reader sees it end inside
+// the header and inside blocks
+void write_slowly()
+{
+  std::string data;
+  {
+    std::ostringstream s;
+    pbsf::write_header(s, TestRealm());
+    for (int i = 0; i != 50; ++i) {
+      pbsf::write_block(s, TestRealm(), i);
+      pbsf::write_block(s, TestRealm(), std::string(std::size_t(i * 100), 'x'));
+    }
+    data = s.str();
+  }
+  pbsf::file_stream out(filename, pbsf::open_mode::update);
+  for (std::size_t i = 0; i < data.size(); i += 1000) {
+    out.write(data.data() + i, static_cast<std::streamsize>(std::min<std::size_t>(1000, data.size() - i)));
+    out.flush();
+    std::this_thread::sleep_for(1ms);
+  }
+}
+
+int main()
+{
+
+  // stored as is, so the file takes many writes
+  char env_entry[] = "PBSF_COMPRESSION=identity";
+  putenv(env_entry);
+
+  std::ofstream(filename, std::ios::trunc);
+  pbsf::follow_reader reader(filename, TestRealm());
+  pbsf::EncodedBlock block;
+  // nothing yet
+  assert(!reader.next(block, 10ms));
+
+  std::thread writer(write_slowly);
+  for (int i = 0; i != 50; ++i) {
+    assert(reader.next(block, 5s));
+    assert(pbss::parse_from_buffer<int>(pbsf::decode_block(std::move(block))) == i);
+    assert(reader.next(block, 5s));
+    auto s = pbss::parse_from_buffer<std::string>(pbsf::decode_block(std::move(block)));
+    assert(s.size() == std::size_t(i * 100));
+  }
+  writer.join();
+  assert(!reader.next(block, 10ms));
+
+  pbsf::follow_reader other(filename, OtherRealm());
+  try {
+    other.next(block, 10ms);
+    assert("unknown realm error not reported" && false);
+  } catch (const pbsf::unknown_realm_error&) {
+    // good
+  }
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cassert>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <bs3/pbsf/pbsf.hh>
+
+PBSF_DECLARE_REALM(TestRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int),
+                   PBSF_REGISTER_TYPE(4, double),
+                   PBSF_REGISTER_TYPE(-3, std::string));
+
+// ids far apart, looked up by binary search
+PBSF_DECLARE_REALM(SparseRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int),
+                   PBSF_REGISTER_TYPE(3000, std::string),
+                   PBSF_REGISTER_TYPE(-3000, double));
+
+// a subset, to skip types it does not know
+PBSF_DECLARE_REALM(IntRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int));
+
+using tdt = pbsf::iter_impl::realm_dispatch_table<TestRealm>;
+static_assert(tdt::index_of(2) == 0 && tdt::index_of(4) == 1 && tdt::index_of(-3) == 2);
+static_assert(tdt::index_of(3) == tdt::npos && tdt::index_of(1000) == tdt::npos);
+using sdt = pbsf::iter_impl::realm_dispatch_table<SparseRealm>;
+static_assert(sdt::index_of(3000) == 1 && sdt::index_of(-3000) == 2);
+static_assert(sdt::index_of(4) == sdt::npos);
+
+struct visitor {
+  std::vector<std::string> seen;
+  void operator()(int x) { seen.push_back("i" + std::to_string(x)); }
+  void operator()(double x) { seen.push_back("d" + std::to_string(int(x))); }
+  void operator()(const std::string& x) { seen.push_back("s" + x); }
+};
+
+template <class Realm>
+void check(const char* filename)
+{
+  using V = pbsf::realm_variant<Realm>;
+  {
+    auto f = pbsf::open_sequential_output_file(filename, Realm());
+    auto out = f.write_iterator();
+    *out++ = 1;
+    *out++ = std::string("two");
+    *out++ = 3.0;
+    *out++ = 4;
+  }
+
+  std::vector<V> values;
+  auto f = pbsf::open_sequential_input_file(filename, Realm());
+  for (const V& v : f.read_all_types())
+    values.push_back(v);
+  assert(values.size() == 4);
+  assert(std::get<int>(values[0]) == 1);
+  assert(std::get<std::string>(values[1]) == "two");
+  assert(std::get<double>(values[2]) == 3.0);
+  assert(std::get<int>(values[3]) == 4);
+
+  visitor vis;
+  pbsf::visit_all_types(pbsf::open_sequential_input_file(filename, Realm()), vis);
+  assert((vis.seen == std::vector<std::string>{"i1", "stwo", "d3", "i4"}));
+
+  // types not in the realm are skipped, and not decoded
+  visitor ints;
+  auto g = pbsf::open_sequential_input_file(filename, IntRealm());
+  g.visit_all_types(ints);
+  assert((ints.seen == std::vector<std::string>{"i1", "i4"}));
+}
+
+int main()
+{
+
+  check<TestRealm>("test-heterogeneous-read-fixture");
+  check<SparseRealm>("test-heterogeneous-read-fixture");
+
+  // decode_variant refuses types outside the realm
+  try {
+    pbsf::decode_variant<IntRealm>(pbsf::encode_block(4, pbss::serialize_to_buffer(1.0)));
+    assert("type mismatch error not reported" && false);
+  } catch (const pbsf::type_mismatch_error&) {
+    // good
+  }
+
+  return 0;
+}
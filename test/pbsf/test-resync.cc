@@ -0,0 +1,190 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <random>
+#include <string>
+
+#include <bs3/pbsf/pbsf.hh>
+#include <bs3/pbsf/resync.hh>
+
+PBSF_DECLARE_REALM(TestRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int),
+                   PBSF_REGISTER_TYPE(4, std::string));
+
+int main()
+{
+
+  const char* filename = "test-resync-fixture";
+
+  // stored as is, for damaging at known places
+  char env_entry[] = "PBSF_COMPRESSION=identity";
+  putenv(env_entry);
+
+  std::vector<std::streamoff> offsets;
+  std::mt19937 gen(42);
+  auto write_fixture = [&](std::streamoff garbage_at) {
+    offsets.clear();
+    auto f = pbsf::open_sequential_output_file(filename, TestRealm());
+    auto& s = *f.stream_ptr;
+    for (int i = 0; i < 30; ++i) {
+      if (i == garbage_at)
+        for (int j = 0; j < 1000; ++j)
+          s.put(static_cast<char>(gen()));
+      offsets.push_back(s.tellp());
+      if (i % 2)
+        write_block(s, TestRealm(), std::string(std::size_t(i) * 1000, char('a' + i)));
+      else
+        write_block(s, TestRealm(), i);
+    }
+    offsets.push_back(s.tellp());
+  };
+
+  // reads all that is left, checking the blocks are the ones written
+  auto read_all = [&](std::vector<pbsf::damaged_range>& damage) {
+    pbsf::resync_reader r(filename, TestRealm());
+    std::vector<int> seen;
+    pbsf::EncodedBlock block;
+    while (r.next(block)) {
+      auto i = static_cast<int>(std::find(offsets.begin(), offsets.end(), r.offset())
+                                - offsets.begin());
+      assert(i < 30);
+      auto content = pbsf::decode_block(std::move(block));
+      if (i % 2)
+        assert(pbss::parse_from_buffer<std::string>(content)
+               == std::string(std::size_t(i) * 1000, char('a' + i)));
+      else
+        assert(pbss::parse_from_buffer<int>(content) == i);
+      seen.push_back(i);
+    }
+    damage = r.damaged();
+    return seen;
+  };
+
+  auto overwrite = [&](std::streamoff at, std::size_t count, char ch) {
+    pbsf::file_stream f(filename, pbsf::open_mode::update);
+    f.seekp(at);
+    for (std::size_t i = 0; i < count; ++i)
+      f.put(ch);
+  };
+
+  auto all_but = [](std::vector<int> skip) {
+    std::vector<int> v;
+    for (int i = 0; i < 30; ++i)
+      if (std::find(skip.begin(), skip.end(), i) == skip.end())
+        v.push_back(i);
+    return v;
+  };
+
+  std::vector<pbsf::damaged_range> damage;
+
+  {
+    // intact
+    write_fixture(-1);
+    assert(read_all(damage) == all_but({}));
+    assert(damage.empty());
+  }
+
+  {
+    // a corrupt content byte loses that block only
+    write_fixture(-1);
+    overwrite(offsets[5] + 100, 1, 'x');
+    assert(read_all(damage) == all_but({5}));
+    assert(damage.size() == 1);
+    assert(damage[0].first == offsets[5] && damage[0].last == offsets[6]);
+  }
+
+  {
+    // zeros over several blocks and a header
+    write_fixture(-1);
+    overwrite(offsets[10] + 2, static_cast<std::size_t>(offsets[13] - offsets[10]), 0);
+    assert(read_all(damage) == all_but({10, 11, 12, 13}));
+    assert(damage.size() == 1);
+    assert(damage[0].first == offsets[10] && damage[0].last == offsets[14]);
+  }
+
+  {
+    // damage on both sides of a block
+    write_fixture(-1);
+    overwrite(offsets[4] + 10, 1, 'x');
+    overwrite(offsets[6], static_cast<std::size_t>(offsets[7] - offsets[6]), 'x');
+    assert(read_all(damage) == all_but({4, 6}));
+    assert(damage.size() == 2);
+    assert(damage[0].first == offsets[4] && damage[0].last == offsets[5]);
+    assert(damage[1].first == offsets[6] && damage[1].last == offsets[7]);
+  }
+
+  {
+    // garbage between blocks, and damage in two places
+    write_fixture(21);
+    overwrite(offsets[3] + 5, 1, 'x');
+    assert(read_all(damage) == all_but({3}));
+    assert(damage.size() == 2);
+    assert(damage[0].first == offsets[3] && damage[0].last == offsets[4]);
+    assert(damage[1].first == offsets[21] - 1000 && damage[1].last == offsets[21]);
+  }
+
+  {
+    // truncated in the last block
+    write_fixture(-1);
+    std::filesystem::resize_file(filename, static_cast<std::uintmax_t>(offsets[29] + 5));
+    assert(read_all(damage) == all_but({29}));
+    assert(damage.size() == 1);
+    assert(damage[0].first == offsets[29] && damage[0].last == offsets[29] + 5);
+  }
+
+  {
+    // a block found by scanning may be followed by a footer
+    std::vector<std::streamoff> at;
+    {
+      auto f = pbsf::open_sequential_output_file(filename, TestRealm(), true, true);
+      auto& s = *f.stream_ptr;
+      for (int i = 0; i < 3; ++i) {
+        at.push_back(s.tellp());
+        write_block(s, TestRealm(), i);
+      }
+    }
+    overwrite(at[2] - 1, 1, 'x');
+    pbsf::resync_reader r(filename, TestRealm());
+    pbsf::EncodedBlock block;
+    assert(r.next(block) && r.offset() == at[0]);
+    assert(r.next(block) && r.offset() == at[2]);
+    assert(r.damaged().size() == 1);
+  }
+
+  {
+    // wrong realm
+    write_fixture(-1);
+    PBSF_DECLARE_REALM(WrongRealm, 43, PBSF_REGISTER_TYPE(2, int));
+    try {
+      pbsf::resync_reader r(filename, WrongRealm());
+      assert("unknown realm error not reported" && false);
+    } catch (const pbsf::unknown_realm_error&) {
+      // good
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cassert>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <bs3/pbsf/pbsf.hh>
+
+PBSF_DECLARE_REALM(TestRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int),
+                   PBSF_REGISTER_TYPE(4, std::string));
+
+const char* filename = "test-reverse-fixture";
+
+// 1000 ints, with a string after every seventh, some too long to be kept
+// while reading backwards
+void write_file(bool footer)
+{
+  auto f = pbsf::open_sequential_output_file(filename, TestRealm(), true, footer);
+  auto out = f.write_iterator();
+  for (int i = 0; i != 1000; ++i) {
+    *out++ = i;
+    if (i % 7 == 0)
+      *out++ = std::string(std::size_t(i % 3 ? i : i * 200), 'x');
+  }
+}
+
+void check()
+{
+  auto f = pbsf::open_sequential_input_file(filename, TestRealm());
+
+  int n = 1000;
+  for (int x : f.read_one_type_reversed<int>())
+    assert(x == --n);
+  assert(n == 0);
+
+  n = 1000;
+  for (auto& s : f.read_one_type_reversed<std::string>()) {
+    n = (n - 1) / 7 * 7;
+    assert(s.size() == std::size_t(n % 3 ? n : n * 200));
+  }
+  assert(n == 0);
+
+  std::vector<int> last;
+  for (int x : f.tail<int>(5))
+    last.push_back(x);
+  assert((last == std::vector<int>{ 995, 996, 997, 998, 999 }));
+  last.clear();
+  for (int x : f.tail<int>(2000))
+    last.push_back(x);
+  assert(last.size() == 1000 && last[0] == 0);
+  auto none = f.tail<int>(0);
+  assert(none.begin() == none.end());
+
+  // all blocks: the last is int 999, and the first int 0 then string 0
+  std::vector<int16_t> types;
+  pbsf::reverse_block_iterator<pbsf::file_stream> it(*f.stream_ptr, f.blocks()), end;
+  for (; it != end; ++it)
+    types.push_back(it->contentType);
+  assert(types.size() == f.blocks().size());
+  assert(types.front() == 2 && types[types.size() - 2] == 4 && types.back() == 2);
+}
+
+int main()
+{
+
+  write_file(true);
+  check();
+
+  write_file(false);
+  check();
+
+  // truncated after the table was read
+  pbsf::block_table t = pbsf::open_sequential_input_file(filename, TestRealm()).blocks();
+  std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 1);
+  auto f = pbsf::open_sequential_input_file(filename, TestRealm());
+  try {
+    pbsf::reverse_block_iterator<pbsf::file_stream> it(*f.stream_ptr, t);
+    assert("early eof not reported" && false);
+  } catch (const pbss::early_eof_error&) {
+    // good
+  }
+
+  return 0;
+}
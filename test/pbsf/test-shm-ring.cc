@@ -0,0 +1,144 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <bs3/pbsf/pbsf.hh>
+#include <bs3/pbsf/shm-ring.hh>
+
+PBSF_DECLARE_REALM(TestRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int),
+                   PBSF_REGISTER_TYPE(4, std::string));
+
+PBSF_DECLARE_REALM(OtherRealm, 43,
+                   PBSF_REGISTER_TYPE(2, int));
+
+const int count = 20000;
+
+void produce(pbsf::sequential_file<pbsf::ring_writer, TestRealm> f)
+{
+  auto out = f.write_iterator();
+  for (int i = 0; i != count; ++i) {
+    *out++ = i;
+    if (i % 10 == 0)
+      *out++ = std::string(std::size_t(i % 1000), 'x');
+  }
+}
+
+// every int in order, and the strings between
+void consume(pbsf::sequential_file<pbsf::ring_reader, TestRealm> f, int& ints)
+{
+  int strings = 0;
+  for (auto& v : f.read_all_types()) {
+    if (auto x = std::get_if<int>(&v)) {
+      assert(*x == ints++);
+    } else {
+      assert(std::get<std::string>(v).size() == std::size_t(strings * 10 % 1000));
+      ++strings;
+    }
+  }
+}
+
+int main()
+{
+
+  auto name = "/pbsf-test-shm-ring-" + std::to_string(::getpid());
+
+  // a small ring, so the writer waits for the readers
+  {
+    pbsf::ring_options options;
+    options.capacity = 4096;
+    std::thread writer;
+    int ints[2] = { 0, 0 };
+    std::vector<std::thread> readers;
+    {
+      auto out = pbsf::open_ring_output(name, TestRealm(), options);
+      for (int i = 0; i != 2; ++i)
+        readers.emplace_back(consume, pbsf::open_ring_input(name, TestRealm()), std::ref(ints[i]));
+      writer = std::thread(produce, std::move(out));
+    }
+    writer.join();
+    for (auto& t : readers)
+      t.join();
+    assert(ints[0] == count && ints[1] == count);
+  }
+
+  // or overwrites what they have not read
+  {
+    pbsf::ring_options options;
+    options.capacity = 4096;
+    options.overflow = pbsf::overflow_policy::drop;
+    auto out = pbsf::open_ring_output(name, TestRealm(), options);
+    auto in = pbsf::open_ring_input(name, TestRealm());
+    produce(std::move(out));
+    out = {};
+    int last = -1;
+    for (int x : in.read_one_type<int>()) {
+      assert(x > last);
+      last = x;
+    }
+    assert(last == count - 1);
+    assert(in.stream_ptr->dropped() > 0);
+  }
+
+  {
+    auto out = pbsf::open_ring_output(name, TestRealm());
+    try {
+      pbsf::open_ring_input(name, OtherRealm());
+      assert("unknown realm error not reported" && false);
+    } catch (const pbsf::unknown_realm_error&) {
+      // good
+    }
+  }
+
+  // created but never sized, as by a writer that died setting it up
+  {
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    assert(fd >= 0);
+    ::close(fd);
+    try {
+      pbsf::ring_reader in(name);
+      assert("unsized ring not reported" && false);
+    } catch (const std::runtime_error&) {
+      // good
+    }
+    ::shm_unlink(name.c_str());
+  }
+
+  // gone with its writer
+  try {
+    pbsf::ring_reader in(name);
+    assert("missing ring not reported" && false);
+  } catch (const std::system_error&) {
+    // good
+  }
+
+  return 0;
+}
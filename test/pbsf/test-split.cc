@@ -0,0 +1,90 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include <bs3/pbsf/pbsf.hh>
+#include <bs3/pbsf/split.hh>
+
+PBSF_DECLARE_REALM(TestRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int),
+                   PBSF_REGISTER_TYPE(4, std::string));
+
+const char* filename = "test-split-fixture";
+
+void write_file(bool footer)
+{
+  auto f = pbsf::open_sequential_output_file(filename, TestRealm(), true, footer);
+  auto out = f.write_iterator();
+  for (int i = 0; i != 5000; ++i) {
+    *out++ = i;
+    if (i % 7 == 0)
+      *out++ = std::string(std::size_t(i % 300), 'x');
+  }
+}
+
+// reads the ranges one after another, expecting every block once; there
+// may be a few ranges less than expected, where cuts fall close together
+void check(std::size_t k, std::size_t expected)
+{
+  auto ranges = pbsf::split_file(filename, TestRealm(), k);
+  assert(ranges.size() <= expected);
+  assert(ranges.size() * 5 >= expected * 4);
+  int n = 0;
+  std::size_t strings = 0;
+  for (std::size_t i = 0; i != ranges.size(); ++i) {
+    assert(ranges[i].first < ranges[i].last);
+    if (i)
+      assert(ranges[i].first == ranges[i-1].last);
+    auto f = pbsf::open_file_range(filename, TestRealm(), ranges[i]);
+    for (int x : f.read_one_type<int>())
+      assert(x == n++);
+    auto g = pbsf::open_file_range(filename, TestRealm(), ranges[i]);
+    for (auto& s : g.read_one_type<std::string>()) {
+      assert(s.size() == strings * 7 % 300);
+      ++strings;
+    }
+  }
+  assert(n == 5000);
+  assert(strings == 715);
+}
+
+int main()
+{
+
+  write_file(false);
+  check(1, 1);
+  check(4, 4);
+  check(32, 32);
+
+  write_file(true);
+  check(1, 1);
+  check(4, 4);
+  // blocks are sampled every 256 of a type, so there are only 23 places
+  // to cut, some of them adjacent
+  check(1000, 23);
+
+  return 0;
+}
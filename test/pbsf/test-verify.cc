@@ -0,0 +1,119 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <bs3/pbsf/pbsf.hh>
+#include <bs3/pbsf/verify.hh>
+
+PBSF_DECLARE_REALM(TestRealm, 42,
+                   PBSF_REGISTER_TYPE(2, int),
+                   PBSF_REGISTER_TYPE(4, std::string));
+
+int main()
+{
+
+  const char* filename = "test-verify-fixture";
+
+  // stored as is, for corrupting at known places
+  char env_entry[] = "PBSF_COMPRESSION=identity";
+  putenv(env_entry);
+
+  // blocks of all sizes, some spanning several pieces
+  std::vector<std::streamoff> offsets;
+  {
+    auto f = pbsf::open_sequential_output_file(filename, TestRealm());
+    auto& s = *f.stream_ptr;
+    for (int i = 0; i < 20; ++i) {
+      offsets.push_back(s.tellp());
+      write_block(s, TestRealm(), i);
+      offsets.push_back(s.tellp());
+      std::string str(std::size_t(i) << (i == 15 ? 20 : 14), char('a' + i));
+      for (std::size_t j = 0; j < str.size(); j += 7)
+        str[j] = char(j);
+      write_block(s, TestRealm(), str);
+    }
+  }
+
+  for (bool decode : {false, true})
+    for (unsigned threads : {1u, 3u}) {
+      auto r = pbsf::verify_file(filename, { threads, decode });
+      assert(r.ok());
+      assert(r.realm == 42);
+      assert(r.blocks == 40);
+    }
+
+  auto corrupt = [&](std::streamoff pos) {
+    std::fstream f(filename, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    f.seekg(pos);
+    char c = static_cast<char>(f.get() ^ 0x10);
+    f.seekp(pos);
+    f.put(c);
+  };
+
+  {
+    // corrupt content is found, by checksum or by decoding
+    corrupt(offsets[5] + 40);
+    corrupt(offsets[31] + (std::streamoff(12) << 20));
+    for (bool decode : {false, true}) {
+      auto r = pbsf::verify_file(filename, { 2, decode });
+      assert(r.blocks == 40);
+      assert(r.errors.size() == 2);
+      assert(r.errors[0].offset == offsets[5]);
+      assert(r.errors[0].contentType == 4);
+      assert(r.errors[1].offset == offsets[31]);
+      assert(r.errors[1].what == "checksum mismatch");
+    }
+    corrupt(offsets[5] + 40);
+    corrupt(offsets[31] + (std::streamoff(12) << 20));
+    assert(pbsf::verify_file(filename).ok());
+  }
+
+  {
+    // a truncated file ends the scan at the broken block
+    std::filesystem::resize_file(filename, static_cast<std::uintmax_t>(offsets[39] + 100));
+    auto r = pbsf::verify_file(filename);
+    assert(r.blocks == 39);
+    assert(r.errors.size() == 1);
+    assert(r.errors[0].offset == offsets[39]);
+    std::filesystem::resize_file(filename, static_cast<std::uintmax_t>(offsets[39] + 3));
+    r = pbsf::verify_file(filename);
+    assert(r.blocks == 39);
+    assert(r.errors.size() == 1 && r.errors[0].what == "truncated block header");
+  }
+
+  {
+    // not a pbsf file
+    {
+      std::ofstream out(filename);
+      out << "hello, world";
+    }
+    auto r = pbsf::verify_file(filename);
+    assert(!r.ok() && r.blocks == 0 && r.errors[0].offset == 0);
+  }
+
+  return 0;
+}
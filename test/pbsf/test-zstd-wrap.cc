@@ -22,6 +22,7 @@
 */
 
 #include <cassert>
+#include <bs3/pbsf/crc-32.hh>
 #include "zstd-wrap.hh"
 
 int main()
@@ -33,5 +34,34 @@ int main()
   pbss::buffer raw(2<<20, 'a');
   assert(zstd_decompress(zstd_compress(raw)) == raw);
 
+  {
+    // the checksumming ones compute crc32c of the compressed data
+    pbss::buffer mixed(3<<20);
+    for (size_t i = 0; i < mixed.size(); ++i)
+      mixed[i] = static_cast<char>(i * i >> 7);
+    uint32_t crc_out = 0, crc_in = 1;
+    auto compressed = zstd_compress(mixed, crc_out);
+    assert(crc_out == pbsf::crc32c(compressed));
+    assert(zstd_decompress(compressed, crc_in) == mixed);
+    assert(crc_in == crc_out);
+    assert(zstd_decompress(zstd_compress(mixed)) == mixed);
+    assert(zstd_decompress(compressed) == mixed);
+
+    pbss::buffer empty;
+    compressed = zstd_compress(empty, crc_out);
+    assert(crc_out == pbsf::crc32c(compressed));
+    assert(zstd_decompress(compressed, crc_in).empty());
+    assert(crc_in == crc_out);
+
+    // truncated input throws
+    compressed.resize(compressed.size() - 1);
+    try {
+      zstd_decompress(compressed, crc_in);
+      assert("truncated input not reported" && false);
+    } catch (const std::runtime_error&) {
+      // good
+    }
+  }
+
   return 0;
 }
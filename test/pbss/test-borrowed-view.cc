@@ -0,0 +1,126 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include "checker.hh"
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+struct waveform {
+  std::vector<int8_t> samples;
+  std::string name;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &waveform::samples),
+    PBSS_TAG_MEMBER(2, &waveform::name));
+};
+
+struct waveform_view {
+  std::span<const int8_t> samples;
+  std::string_view name;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &waveform_view::samples),
+    PBSS_TAG_MEMBER(2, &waveform_view::name));
+};
+
+int main()
+{
+
+  {
+    // spans and string views serialize the same as owning containers
+    std::vector<int32_t> v {1, 2, 3};
+    check_serialize(std::span<const int32_t>(v), serialize_to_string_by_stream(v));
+    check_serialize(std::span<int32_t>(v), serialize_to_string_by_stream(v));
+    check_serialize(std::string_view("abc"), serialize_to_string_by_stream(std::string("abc")));
+  }
+
+  {
+    // string views point into the input
+    auto buf = pbss::serialize_to_buffer(std::string("hello"));
+    auto sv = pbss::parse_from_buffer<std::string_view>(buf);
+    assert(sv == "hello");
+    assert(sv.data() == reinterpret_cast<const char*>(buf.data()) + 1);
+  }
+
+  {
+    // also as struct members
+    auto str = pbss::serialize_to_string(waveform{{1, 2, 3, 4}, "ch0"});
+    auto view = pbss::parse_from_string<waveform_view>(str);
+    assert(view.samples.size() == 4);
+    assert(view.samples[0] == 1 && view.samples[3] == 4);
+    assert(view.name == "ch0");
+    assert(view.name.data() >= str.data() && view.name.data() < str.data() + str.size());
+  }
+
+  {
+    // aligned views of wider types
+    alignas(8) char raw[8 + 2*sizeof(double)] = {};
+    raw[7] = 2;
+    double values[] = {1.5, -2.5};
+    std::char_traits<char>::copy(raw + 8, reinterpret_cast<const char*>(values), sizeof values);
+    pbss::char_range_reader reader(raw + 7, raw + sizeof raw);
+    auto span = pbss::parse<std::span<const double>>(reader);
+    assert(span.size() == 2 && span[0] == 1.5 && span[1] == -2.5);
+    assert(span.data() == reinterpret_cast<const double*>(raw + 8));
+
+    // misaligned ones are refused
+    raw[6] = 1;
+    pbss::char_range_reader misaligned(raw + 6, raw + sizeof raw);
+    try {
+      pbss::parse<std::span<const double>>(misaligned);
+      assert("Expected unaligned_view_error but it did not throw" && false);
+    } catch (const pbss::unaligned_view_error&) {
+      // good
+    }
+  }
+
+  {
+    // early eof
+    try {
+      pbss::parse_from_string<std::string_view>("\x3""ab");
+      assert("Expected early_eof_error but it did not throw" && false);
+    } catch (const pbss::early_eof_error&) {
+      // good
+    }
+
+    // sizes whose byte count would wrap around
+    alignas(8) char raw[32] = {};
+    auto size = pbss::serialize_to_string(pbss::make_var_uint((std::size_t(1) << 61) + 1));
+    std::char_traits<char>::copy(raw + 16 - size.size(), size.data(), size.size());
+    pbss::char_range_reader huge(raw + 16 - size.size(), raw + sizeof raw);
+    try {
+      pbss::parse<std::span<const double>>(huge);
+      assert("Expected early_eof_error but it did not throw" && false);
+    } catch (const pbss::early_eof_error&) {
+      // good
+    }
+
+    // negative counts borrow nothing
+    pbss::char_range_reader reader(raw, raw + sizeof raw);
+    assert(!reader.borrow(-1) && reader.eof());
+  }
+
+  return 0;
+}
@@ -0,0 +1,206 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include "checker.hh"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// the part of the std::flat_map interface used by pbss, which is not
+// available everywhere yet
+template <class Key, class T, class Compare=std::less<Key>>
+struct sorted_vector_map {
+
+  typedef Key key_type;
+  typedef T mapped_type;
+  typedef std::pair<Key, T> value_type;
+  typedef Compare key_compare;
+  typedef std::size_t size_type;
+  typedef std::vector<Key> key_container_type;
+  typedef std::vector<T> mapped_container_type;
+
+  key_container_type k;
+  mapped_container_type v;
+  int replaced = 0;
+
+  sorted_vector_map() = default;
+
+  // sorts, keeping the first of equal keys
+  sorted_vector_map(key_container_type keys, mapped_container_type values,
+                    const Compare& comp)
+  {
+    std::vector<size_type> order(keys.size());
+    std::iota(order.begin(), order.end(), size_type(0));
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_type a, size_type b) { return comp(keys[a], keys[b]); });
+    for (auto i : order)
+      if (k.empty() || comp(k.back(), keys[i])) {
+        k.push_back(keys[i]);
+        v.push_back(values[i]);
+      }
+  }
+
+  key_compare key_comp() const
+  {
+    return key_compare();
+  }
+
+  void replace(key_container_type&& keys, mapped_container_type&& values)
+  {
+    k = std::move(keys);
+    v = std::move(values);
+    ++replaced;
+  }
+
+  std::pair<int, bool> insert(const value_type&)
+  {
+    // not expected to be used
+    assert(false);
+    return {};
+  }
+
+  size_type size() const
+  {
+    return k.size();
+  }
+
+};
+
+template <class Key, class Compare=std::less<Key>>
+struct sorted_vector_set {
+
+  typedef Key key_type;
+  typedef Key value_type;
+  typedef Compare key_compare;
+  typedef std::size_t size_type;
+  typedef std::vector<Key> container_type;
+
+  container_type k;
+  int replaced = 0;
+
+  sorted_vector_set() = default;
+
+  sorted_vector_set(container_type keys, const Compare& comp)
+    : k(std::move(keys))
+  {
+    std::stable_sort(k.begin(), k.end(), comp);
+    k.erase(std::unique(k.begin(), k.end()), k.end());
+  }
+
+  key_compare key_comp() const
+  {
+    return key_compare();
+  }
+
+  void replace(container_type&& keys)
+  {
+    k = std::move(keys);
+    ++replaced;
+  }
+
+  std::pair<int, bool> insert(const value_type&)
+  {
+    assert(false);
+    return {};
+  }
+
+  size_type size() const
+  {
+    return k.size();
+  }
+
+};
+
+template <class T>
+T parse_string(const std::string& str)
+{
+  return pbss::parse_from_string<T>(str);
+}
+
+int main()
+{
+  std::map<int16_t, std::string> map{{1, "a"}, {3, "bc"}, {7, ""}, {9, "d"}};
+  auto wire = pbss::serialize_to_string(map);
+
+  // ordered containers, from sorted input
+  assert((parse_string<std::map<int16_t, std::string>>(wire) == map));
+  check_parse("\x5""abcde", std::set<char>{'a', 'b', 'c', 'd', 'e'});
+
+  // and from input in any order, keeping the first of equal keys like
+  // unhinted insertion does
+  check_parse("\x5""cdaeb", std::set<char>{'a', 'b', 'c', 'd', 'e'});
+  check_parse("\x6""cdaebc", std::set<char>{'a', 'b', 'c', 'd', 'e'});
+  {
+    auto unsorted = pbss::serialize_to_string(
+      std::vector<std::pair<int16_t, char>>{{5, 'a'}, {2, 'b'}, {5, 'c'}, {9, 'd'}, {1, 'e'}});
+    assert((parse_string<std::map<int16_t, char>>(unsorted) ==
+            std::map<int16_t, char>{{1, 'e'}, {2, 'b'}, {5, 'a'}, {9, 'd'}}));
+    // equal keys keep their order in multimaps
+    auto multi = parse_string<std::multimap<int16_t, char>>(unsorted);
+    assert((std::vector<std::pair<const int16_t, char>>(multi.begin(), multi.end()) ==
+            std::vector<std::pair<const int16_t, char>>{{1, 'e'}, {2, 'b'}, {5, 'a'}, {5, 'c'}, {9, 'd'}}));
+  }
+
+  // sorted-vector map adopts sorted input as-is
+  {
+    auto flat = parse_string<sorted_vector_map<int16_t, std::string>>(wire);
+    assert(flat.replaced == 1);
+    assert((flat.k == std::vector<int16_t>{1, 3, 7, 9}));
+    assert((flat.v == std::vector<std::string>{"a", "bc", "", "d"}));
+  }
+  {
+    auto flat = parse_string<sorted_vector_map<int16_t, std::string>>({0});
+    assert(flat.replaced == 1 && flat.size() == 0);
+  }
+
+  // and sorts anything else
+  {
+    auto unsorted = pbss::serialize_to_string(
+      std::vector<std::pair<int16_t, char>>{{5, 'a'}, {2, 'b'}, {5, 'c'}, {9, 'd'}});
+    auto flat = parse_string<sorted_vector_map<int16_t, char>>(unsorted);
+    assert(flat.replaced == 0);
+    assert((flat.k == std::vector<int16_t>{2, 5, 9}));
+    assert((flat.v == std::vector<char>{'b', 'a', 'd'}));
+  }
+
+  // sorted-vector set likewise
+  {
+    auto flat = parse_string<sorted_vector_set<char>>("\x3""abc");
+    assert(flat.replaced == 1 && (flat.k == std::vector<char>{'a', 'b', 'c'}));
+  }
+  {
+    auto flat = parse_string<sorted_vector_set<char>>("\x4""cabc");
+    assert(flat.replaced == 0 && (flat.k == std::vector<char>{'a', 'b', 'c'}));
+  }
+
+  check_early_eof<sorted_vector_map<int16_t, std::string>>(wire.substr(0, wire.size()-1));
+  check_early_eof<sorted_vector_set<char>>("\x3""ab");
+
+  return 0;
+}
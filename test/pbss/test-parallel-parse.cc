@@ -0,0 +1,135 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+// small enough for tests
+#define PBSS_PARALLEL_PARSE_THRESHOLD 64
+
+#include "checker.hh"
+
+struct hit {
+  int32_t time;
+  std::string note;
+
+  bool operator==(const hit& other) const
+  {
+    return time==other.time && note==other.note;
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &hit::time),
+    PBSS_TAG_MEMBER(2, &hit::note));
+};
+
+struct channel {
+  uint32_t id;
+  std::vector<hit> hits;
+
+  bool operator==(const channel& other) const
+  {
+    return id==other.id && hits==other.hits;
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &channel::id),
+    PBSS_TAG_MEMBER(2, &channel::hits));
+};
+
+struct event {
+  uint32_t number;
+  std::vector<channel> channels;
+
+  bool operator==(const event& other) const
+  {
+    return number==other.number && channels==other.channels;
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &event::number),
+    PBSS_TAG_MEMBER(2, &event::channels));
+};
+
+static event make_event(unsigned nchannels)
+{
+  event e {42, {}};
+  for (unsigned c = 0; c != nchannels; ++c) {
+    channel ch {c, {}};
+    // sizes differ much, to split unevenly
+    for (unsigned h = 0; h != c*c % 17; ++h)
+      ch.hits.push_back({int32_t(c*100+h), std::string(h, 'x')});
+    e.channels.push_back(ch);
+  }
+  return e;
+}
+
+int main()
+{
+  // same as parsed sequentially, by any number of threads
+  for (unsigned nchannels : {0u, 1u, 2u, 3u, 50u}) {
+    auto e = make_event(nchannels);
+    auto buf = pbss::serialize_to_buffer(e);
+    assert(pbss::parse_from_buffer<event>(buf) == e);
+    for (unsigned threads : {0u, 1u, 2u, 3u, 8u, 64u})
+      assert(pbss::parse_from_buffer_parallel<event>(buf, threads) == e);
+  }
+
+  // nested sequences parsed in parallel
+  {
+    std::vector<event> events {make_event(1), make_event(40)};
+    auto buf = pbss::serialize_to_buffer(events);
+    assert(pbss::parse_from_buffer_parallel<std::vector<event>>(buf, 4) == events);
+  }
+
+  // sequences above the threshold, but no element large enough
+  {
+    std::vector<event> events;
+    for (unsigned i = 0; i != 20; ++i)
+      events.push_back(make_event(i % 3));
+    auto buf = pbss::serialize_to_buffer(events);
+    assert(pbss::parse_from_buffer_parallel<std::vector<event>>(buf, 4) == events);
+  }
+
+  // proxy containers, whose elements share storage, sequentially
+  {
+    std::vector<bool> bits(1000);
+    for (std::size_t i = 0; i != bits.size(); ++i)
+      bits[i] = i % 3 == 0;
+    auto buf = pbss::serialize_to_buffer(bits);
+    assert(pbss::parse_from_buffer_parallel<std::vector<bool>>(buf, 4) == bits);
+  }
+
+  // early eof found by the boundary scan
+  {
+    auto buf = pbss::serialize_to_buffer(make_event(50));
+    for (auto cut : {buf.size()/2, buf.size()-2}) {
+      pbss::buffer truncated(buf.begin(), buf.begin() + pbss::to_signed(cut));
+      try {
+        pbss::parse_from_buffer_parallel<event>(truncated, 4);
+        assert("Expected early_eof_error but it did not throw" && false);
+      } catch (const pbss::early_eof_error&) {
+        // good
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+// small enough for tests
+#define PBSS_PARALLEL_SERIALIZE_THRESHOLD 64
+
+#include <list>
+
+#include "checker.hh"
+
+struct hit {
+  int32_t time;
+  double area;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &hit::time),
+    PBSS_TAG_MEMBER(2, &hit::area));
+};
+
+struct channel {
+  uint32_t id;
+  std::string name;
+  std::vector<hit> hits;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &channel::id),
+    PBSS_TAG_MEMBER(2, &channel::name),
+    PBSS_TAG_MEMBER(3, &channel::hits));
+};
+
+struct event {
+  uint32_t number;
+  std::vector<channel> channels;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &event::number),
+    PBSS_TAG_MEMBER(2, &event::channels));
+};
+
+static event make_event(unsigned nchannels)
+{
+  event e {42, {}};
+  for (unsigned c = 0; c != nchannels; ++c) {
+    channel ch {c, std::string(c % 5, 'x'), {}};
+    // sizes differ much, to split unevenly
+    for (unsigned h = 0; h != c*c % 17; ++h)
+      ch.hits.push_back({int32_t(c*100+h), h*0.5});
+    e.channels.push_back(ch);
+  }
+  return e;
+}
+
+template <class T>
+static void check_same_output(const T& value)
+{
+  auto expected = pbss::serialize_to_buffer(value);
+  for (unsigned threads : {0u, 1u, 2u, 3u, 8u, 64u})
+    assert(pbss::serialize_to_buffer_parallel(value, threads) == expected);
+}
+
+int main()
+{
+  // same as serialized sequentially, by any number of threads
+  for (unsigned nchannels : {0u, 1u, 2u, 3u, 50u})
+    check_same_output(make_event(nchannels));
+
+  // nested sequences serialized in parallel
+  check_same_output(std::vector<event>{make_event(1), make_event(40)});
+
+  // sequences above the threshold, but no element large enough
+  {
+    std::vector<event> events;
+    for (unsigned i = 0; i != 20; ++i)
+      events.push_back(make_event(i % 3));
+    check_same_output(events);
+  }
+
+  // elements of fixed size, and of sequences not indexable
+  check_same_output(make_event(50).channels[49].hits);
+  check_same_output(std::list<std::string>(40, "abc"));
+
+  return 0;
+}
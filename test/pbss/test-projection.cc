@@ -0,0 +1,133 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include "checker.hh"
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct hit {
+  int32_t start;
+  int32_t peak;
+  double area;
+  std::string note;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &hit::start),
+    PBSS_TAG_MEMBER(2, &hit::peak),
+    PBSS_TAG_MEMBER(3, &hit::area),
+    PBSS_TAG_MEMBER(4, &hit::note));
+};
+
+struct channel {
+  uint32_t id;
+  std::vector<hit> hits;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &channel::id),
+    PBSS_TAG_MEMBER(2, &channel::hits));
+};
+
+struct event {
+  uint32_t run;
+  std::map<int, channel> channels;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &event::run),
+    PBSS_TAG_MEMBER(2, &event::channels));
+};
+
+// more members than PBSS_STRUCT_OPTIMISTIC_PARSE_THRESHOLD
+struct large {
+  int a, b, c, d, e, f, g, h, i;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &large::a), PBSS_TAG_MEMBER(2, &large::b),
+    PBSS_TAG_MEMBER(3, &large::c), PBSS_TAG_MEMBER(4, &large::d),
+    PBSS_TAG_MEMBER(5, &large::e), PBSS_TAG_MEMBER(6, &large::f),
+    PBSS_TAG_MEMBER(7, &large::g), PBSS_TAG_MEMBER(8, &large::h),
+    PBSS_TAG_MEMBER(9, &large::i));
+};
+
+int main()
+{
+
+  using pbss::projection;
+
+  {
+    // only listed members are materialized
+    auto buf = pbss::serialize_to_buffer(hit{1, 2, 3.5, "x"});
+    auto h = pbss::parse_from_buffer<hit>(buf, projection<&hit::start, &hit::area>());
+    assert(h.start == 1 && h.peak == 0 && h.area == 3.5 && h.note.empty());
+
+    // also from std::istream
+    std::istringstream in(pbss::serialize_to_string(hit{1, 2, 3.5, "x"}) + "pad");
+    h = pbss::parse<hit>(in, projection<&hit::note>());
+    assert(h.start == 0 && h.area == 0 && h.note == "x");
+    assert("Parse shall not consume extra bytes than needed" && in.rdbuf()->in_avail() == 3);
+  }
+
+  {
+    // recursively through containers; unmentioned structs are parsed in
+    // full
+    event ev { 7, { {1, {10, { {1, 2, 3.5, "a"}, {4, 5, 6.5, "b"} } } } } };
+    auto buf = pbss::serialize_to_buffer(ev);
+
+    auto p = pbss::parse_from_buffer<event>(buf, projection<&hit::area>());
+    assert(p.run == 7 && p.channels.at(1).id == 10);
+    auto& hits = p.channels.at(1).hits;
+    assert(hits.size() == 2);
+    assert(hits[0].area == 3.5 && hits[1].area == 6.5);
+    assert(hits[0].start == 0 && hits[1].note.empty());
+
+    p = pbss::parse_from_buffer<event>(buf, projection<&event::run>());
+    assert(p.run == 7 && p.channels.empty());
+
+    p = pbss::parse_from_buffer<event>(
+      buf, projection<&event::channels, &channel::hits, &hit::start>());
+    assert(p.run == 0 && p.channels.at(1).id == 0);
+    assert(p.channels.at(1).hits[1].start == 4 && p.channels.at(1).hits[1].area == 0);
+  }
+
+  {
+    // optimistic parsing of large structs
+    auto buf = pbss::serialize_to_buffer(large{1, 2, 3, 4, 5, 6, 7, 8, 9});
+    auto l = pbss::parse_from_buffer<large>(buf, projection<&large::b, &large::i>());
+    assert(l.a == 0 && l.b == 2 && l.c == 0 && l.h == 0 && l.i == 9);
+  }
+
+  {
+    // ignored members are still checked for early eof
+    auto str = pbss::serialize_to_string(hit{1, 2, 3.5, "x"});
+    str.resize(str.size() - 3);
+    try {
+      pbss::parse_from_buffer<hit>({ str.begin(), str.end() }, projection<&hit::start>());
+      assert("Expected early_eof_error but it did not throw" && false);
+    } catch (const pbss::early_eof_error&) {
+      // good
+    }
+  }
+
+  return 0;
+}
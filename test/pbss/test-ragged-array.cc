@@ -0,0 +1,114 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cstdlib>
+#include <new>
+
+#include "checker.hh"
+
+// count allocations
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size)
+{
+  ++allocations;
+  if (auto p = std::malloc(size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+using pbss::ragged_array;
+
+int main()
+{
+  std::vector<std::vector<int16_t>> nested {{1, 2, 3}, {}, {4}, {5, 6}};
+  ragged_array<int16_t> ragged;
+  for (auto& row : nested)
+    ragged.append(row);
+
+  assert(ragged.size() == 4);
+  assert(ragged[0].size() == 3 && ragged[0][2] == 3);
+  assert(ragged[1].empty());
+  assert((ragged.values() == std::vector<int16_t>{1, 2, 3, 4, 5, 6}));
+  assert((ragged.offsets() == std::vector<std::size_t>{3, 3, 4, 6}));
+
+  // same wire format as nested sequences, both ways
+  auto wire = pbss::serialize_to_string(nested);
+  check_serialize(ragged, wire);
+  check_parse(wire, ragged);
+  assert(pbss::parse_from_string<decltype(nested)>(pbss::serialize_to_string(ragged)) == nested);
+
+  // two allocations when parsing from memory
+  {
+    allocations = 0;
+    auto parsed = pbss::parse_from_string<ragged_array<int16_t>>(wire);
+    assert(allocations == 2);
+    assert(parsed == ragged);
+  }
+
+  // elements not stored as-is
+  {
+    ragged_array<std::string> strings;
+    strings.append({"a", "bc"});
+    strings.append({});
+    strings.append({"def"});
+    std::vector<std::vector<std::string>> expected {{"a", "bc"}, {}, {"def"}};
+    check_serialize(strings, pbss::serialize_to_string(expected));
+    check_parse(pbss::serialize_to_string(expected), strings);
+  }
+
+  // nothing at all
+  check_serialize(ragged_array<double>(), {0});
+  check_parse({0}, ragged_array<double>());
+
+  // skipped like nested sequences
+  {
+    auto str = wire + "x";
+    pbss::char_range_reader reader(str.data(), str.data() + str.size());
+    pbss::skip<ragged_array<int16_t>>(reader);
+    assert(reader.get() == 'x');
+  }
+
+  // early eof
+  check_early_eof<ragged_array<int16_t>>("");
+  check_early_eof<ragged_array<int16_t>>(wire.substr(0, wire.size()-1));
+  check_early_eof<ragged_array<int16_t>>(wire.substr(0, 2));
+
+  // a row size whose byte count would wrap around
+  check_early_eof<ragged_array<int16_t>>(
+    pbss::serialize_to_string(std::make_pair(
+      pbss::make_var_uint(std::size_t(1)),
+      pbss::make_var_uint((std::size_t(1) << 63) + 1))) + "ab");
+
+  return 0;
+}
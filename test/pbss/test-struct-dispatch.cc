@@ -0,0 +1,224 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include "checker.hh"
+
+// wide enough to have members looked up by the dispatch table
+static_assert(PBSS_STRUCT_DISPATCH_TABLE_THRESHOLD < 20, "struct not wide enough");
+
+struct wide {
+  int16_t m1;
+  int16_t m2;
+  int16_t m3;
+  int16_t m4;
+  int16_t m5;
+  int16_t m6;
+  int16_t m7;
+  int16_t m8;
+  int16_t m9;
+  int16_t m10;
+  int16_t m11;
+  int16_t m12;
+  int16_t m13;
+  int16_t m14;
+  int16_t m15;
+  int16_t m16;
+  int16_t m17;
+  int16_t m18;
+  int16_t m19;
+  int16_t m20;
+  std::string name;
+
+  bool operator==(const wide& other) const
+  {
+    return pbss::serialize_to_string(*this) == pbss::serialize_to_string(other);
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &wide::m1),
+    PBSS_TAG_MEMBER(2, &wide::m2),
+    PBSS_TAG_MEMBER(3, &wide::m3),
+    PBSS_TAG_MEMBER(4, &wide::m4),
+    PBSS_TAG_MEMBER(5, &wide::m5),
+    PBSS_TAG_MEMBER(6, &wide::m6),
+    PBSS_TAG_MEMBER(7, &wide::m7),
+    PBSS_TAG_MEMBER(8, &wide::m8),
+    PBSS_TAG_MEMBER(9, &wide::m9),
+    PBSS_TAG_MEMBER(10, &wide::m10),
+    PBSS_TAG_MEMBER(11, &wide::m11),
+    PBSS_TAG_MEMBER(12, &wide::m12),
+    PBSS_TAG_MEMBER(13, &wide::m13),
+    PBSS_TAG_MEMBER(14, &wide::m14),
+    PBSS_TAG_MEMBER(15, &wide::m15),
+    PBSS_TAG_MEMBER(16, &wide::m16),
+    PBSS_TAG_MEMBER(17, &wide::m17),
+    PBSS_TAG_MEMBER(18, &wide::m18),
+    PBSS_TAG_MEMBER(19, &wide::m19),
+    PBSS_TAG_MEMBER(20, &wide::m20),
+    PBSS_TAG_MEMBER(100, &wide::name));
+};
+
+// same tags, serialized in reverse order
+struct wide_reversed {
+  int16_t m1;
+  int16_t m2;
+  int16_t m3;
+  int16_t m4;
+  int16_t m5;
+  int16_t m6;
+  int16_t m7;
+  int16_t m8;
+  int16_t m9;
+  int16_t m10;
+  int16_t m11;
+  int16_t m12;
+  int16_t m13;
+  int16_t m14;
+  int16_t m15;
+  int16_t m16;
+  int16_t m17;
+  int16_t m18;
+  int16_t m19;
+  int16_t m20;
+  std::string name;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(100, &wide_reversed::name),
+    PBSS_TAG_MEMBER(20, &wide_reversed::m20),
+    PBSS_TAG_MEMBER(19, &wide_reversed::m19),
+    PBSS_TAG_MEMBER(18, &wide_reversed::m18),
+    PBSS_TAG_MEMBER(17, &wide_reversed::m17),
+    PBSS_TAG_MEMBER(16, &wide_reversed::m16),
+    PBSS_TAG_MEMBER(15, &wide_reversed::m15),
+    PBSS_TAG_MEMBER(14, &wide_reversed::m14),
+    PBSS_TAG_MEMBER(13, &wide_reversed::m13),
+    PBSS_TAG_MEMBER(12, &wide_reversed::m12),
+    PBSS_TAG_MEMBER(11, &wide_reversed::m11),
+    PBSS_TAG_MEMBER(10, &wide_reversed::m10),
+    PBSS_TAG_MEMBER(9, &wide_reversed::m9),
+    PBSS_TAG_MEMBER(8, &wide_reversed::m8),
+    PBSS_TAG_MEMBER(7, &wide_reversed::m7),
+    PBSS_TAG_MEMBER(6, &wide_reversed::m6),
+    PBSS_TAG_MEMBER(5, &wide_reversed::m5),
+    PBSS_TAG_MEMBER(4, &wide_reversed::m4),
+    PBSS_TAG_MEMBER(3, &wide_reversed::m3),
+    PBSS_TAG_MEMBER(2, &wide_reversed::m2),
+    PBSS_TAG_MEMBER(1, &wide_reversed::m1));
+};
+
+static wide make_wide()
+{
+  wide w;
+  w.m1 = 100;
+  w.m2 = 200;
+  w.m3 = 300;
+  w.m4 = 400;
+  w.m5 = 500;
+  w.m6 = 600;
+  w.m7 = 700;
+  w.m8 = 800;
+  w.m9 = 900;
+  w.m10 = 1000;
+  w.m11 = 1100;
+  w.m12 = 1200;
+  w.m13 = 1300;
+  w.m14 = 1400;
+  w.m15 = 1500;
+  w.m16 = 1600;
+  w.m17 = 1700;
+  w.m18 = 1800;
+  w.m19 = 1900;
+  w.m20 = 2000;
+  w.name = "wide";
+  return w;
+}
+
+static wide_reversed make_wide_reversed()
+{
+  wide_reversed w;
+  w.m1 = 100;
+  w.m2 = 200;
+  w.m3 = 300;
+  w.m4 = 400;
+  w.m5 = 500;
+  w.m6 = 600;
+  w.m7 = 700;
+  w.m8 = 800;
+  w.m9 = 900;
+  w.m10 = 1000;
+  w.m11 = 1100;
+  w.m12 = 1200;
+  w.m13 = 1300;
+  w.m14 = 1400;
+  w.m15 = 1500;
+  w.m16 = 1600;
+  w.m17 = 1700;
+  w.m18 = 1800;
+  w.m19 = 1900;
+  w.m20 = 2000;
+  w.name = "wide";
+  return w;
+}
+
+int main()
+{
+  auto w = make_wide();
+  auto reversed = pbss::serialize_to_string(make_wide_reversed());
+
+  // in order parse
+  assert(pbss::parse_from_string<wide>(pbss::serialize_to_string(w)) == w);
+
+  // every member looked up out of order
+  assert(pbss::parse_from_string<wide>(reversed) == w);
+
+  // unknown members are skipped, wherever they are
+  {
+    auto with_unknown = std::string("\x63\x3""abc""\xff\x1""x") + reversed;
+    assert(pbss::parse_from_string<wide>(with_unknown) == w);
+  }
+
+  // missing members stay default
+  {
+    wide_reversed partial {};
+    partial.m3 = 3;
+    wide expected {};
+    expected.m3 = 3;
+    assert(pbss::parse_from_string<wide>(pbss::serialize_to_string(partial)) == expected);
+  }
+
+  // projections apply to looked up members too
+  {
+    auto buf = pbss::serialize_to_buffer(make_wide_reversed());
+    auto p = pbss::parse_from_buffer<wide>(buf, pbss::projection<&wide::m2, &wide::name>());
+    wide expected {};
+    expected.m2 = 200;
+    expected.name = "wide";
+    assert(p == expected);
+  }
+
+  // early eof inside a looked up member
+  reversed.resize(reversed.size()-3);
+  check_early_eof<wide>(reversed);
+
+  return 0;
+}
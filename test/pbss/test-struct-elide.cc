@@ -0,0 +1,127 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include "checker.hh"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+struct hit {
+  int16_t channel;
+  int16_t baseline2 = -1;
+  uint8_t saturated;
+  std::string note;
+
+  bool operator==(const hit& other) const
+  {
+    return channel==other.channel && baseline2==other.baseline2 &&
+      saturated==other.saturated && note==other.note;
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &hit::channel),
+    PBSS_TAG_MEMBER(2, &hit::baseline2),
+    PBSS_TAG_MEMBER(3, &hit::saturated),
+    PBSS_TAG_MEMBER(4, &hit::note));
+
+  PBSS_ELIDE_DEFAULTS(&hit::baseline2, &hit::saturated, &hit::note);
+};
+
+struct all_elided {
+  double x;
+  int8_t y;
+
+  bool operator==(const all_elided& other) const
+  {
+    return x==other.x && y==other.y;
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &all_elided::x),
+    PBSS_TAG_MEMBER(2, &all_elided::y));
+
+  PBSS_ELIDE_ALL_DEFAULTS();
+};
+
+struct not_elided {
+  int8_t y;
+
+  bool operator==(const not_elided& other) const
+  {
+    return y==other.y;
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(2, &not_elided::y));
+};
+
+int main()
+{
+  using pbss::struct_tagged_impl::has_elided_member;
+
+  // defaults are left out; the channel is always written
+  check_serialize(hit{3, -1, 0, ""}, {1, 2, 3, 0, 0});
+  check_parse({1, 2, 3, 0, 0}, hit{3, -1, 0, ""});
+  check_serialize(hit{0, -1, 0, ""}, {1, 2, 0, 0, 0});
+
+  // others are written as usual
+  check_serialize(hit{3, 7, 1, "ab"},
+                  {1, 2, 3, 0, 2, 2, 7, 0, 3, 1, 1, 4, 3, 2, 'a', 'b', 0});
+  check_parse({1, 2, 3, 0, 2, 2, 7, 0, 3, 1, 1, 4, 3, 2, 'a', 'b', 0},
+              hit{3, 7, 1, "ab"});
+  // including a value equal to the default of the member type but not to
+  // its initializer
+  check_serialize(hit{3, 0, 0, ""}, {1, 2, 3, 0, 2, 2, 0, 0, 0});
+
+  // sizes follow
+  static_assert(!has_elided_member(not_elided::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME()));
+  static_assert(has_elided_member(all_elided::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME()));
+  assert(pbss::aot_size(hit{3, -1, 0, ""}, pbss::adl_ns_tag()) == 5);
+  assert(pbss::aot_size(hit{3, 7, 1, "ab"}, pbss::adl_ns_tag()) == 17);
+  assert(pbss::aot_size(all_elided{}, pbss::adl_ns_tag()) == 1);
+
+  // all members of a struct, compared bytewise
+  check_serialize(all_elided{0, 0}, {0});
+  check_parse({0}, all_elided{0, 0});
+  {
+    auto str = pbss::serialize_to_string(all_elided{-0.0, 0});
+    assert(str.size() == 11);
+    assert(std::signbit(pbss::parse_from_string<all_elided>(str).x));
+  }
+
+  // readers need not know about elision
+  check_parse({1, 2, 3, 0, 0}, not_elided{0});
+  check_serialize(not_elided{0}, {2, 1, 0, 0});
+
+  // in sequences, including by the parallel writer
+  {
+    std::vector<hit> hits(300, hit{3, -1, 0, ""});
+    hits[7].saturated = 1;
+    auto str = pbss::serialize_to_string(hits);
+    assert(pbss::parse_from_string<std::vector<hit>>(str) == hits);
+    assert(pbss::serialize_to_buffer_parallel(hits, 2) == pbss::serialize_to_buffer(hits));
+  }
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include "checker.hh"
+
+enum class kind : uint8_t { a = 1, b = 2 };
+
+struct record {
+  kind k;
+  int32_t time;
+  double area;
+
+  bool operator==(const record& other) const
+  {
+    return k==other.k && time==other.time && area==other.area;
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &record::k),
+    PBSS_TAG_MEMBER(2, &record::time),
+    PBSS_TAG_MEMBER(3, &record::area));
+};
+
+struct has_bool {
+  bool flag;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &has_bool::flag));
+};
+
+using pbss::struct_tagged_impl::parse_custom_struct_layout;
+
+template <class T>
+bool parses_by_layout(const std::string& str)
+{
+  pbss::char_range_reader reader(str.data(), str.data()+str.size());
+  T obj {};
+  return parse_custom_struct_layout(
+    reader, obj, typename T::PBSS_TAGGED_OBJECT_MEMBER_TYPEDEF_NAME(), 0);
+}
+
+int main()
+{
+  const record r {kind::b, -5, 2};
+  const std::string in_order {
+    1, 1, 2,
+    2, 4, -5, -1, -1, -1,
+    3, 8, 0, 0, 0, 0, 0, 0, 0, 0x40,
+    0};
+
+  check_parse(in_order, r);
+  assert(parses_by_layout<record>(in_order));
+
+  // serialized by the same template, to streams claiming space or not
+  check_serialize(r, in_order);
+  check_serialize(std::vector<record>{r, r}, std::string({2}) + in_order + in_order);
+
+  // anything else falls back
+  {
+    const std::string reordered {
+      2, 4, -5, -1, -1, -1,
+      1, 1, 2,
+      3, 8, 0, 0, 0, 0, 0, 0, 0, 0x40,
+      0};
+    assert(!parses_by_layout<record>(reordered));
+    check_parse(reordered, r);
+
+    auto unknown = in_order;
+    unknown.insert(unknown.size()-1, {9, 1, 'x'});
+    assert(!parses_by_layout<record>(unknown));
+    check_parse(unknown, r);
+  }
+
+  // too short to look ahead at
+  assert(!parses_by_layout<record>(in_order.substr(0, in_order.size()-1)));
+  check_early_eof<record>(in_order.substr(0, in_order.size()-1));
+
+  // the record is consumed exactly
+  check_extra_consume<record>(in_order);
+  assert((pbss::parse_from_string<std::vector<record>>(std::string({2}) + in_order + in_order)
+          == std::vector<record>{r, r}));
+
+  // members that are not memory layout keep the generic path
+  assert(!parses_by_layout<has_bool>(std::string({1, 1, 2, 0})));
+
+  return 0;
+}
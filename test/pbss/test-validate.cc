@@ -0,0 +1,167 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include "checker.hh"
+
+#include <array>
+#include <list>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct inner {
+  int16_t a;
+  std::string s;
+
+  bool operator==(const inner& other) const
+  {
+    return a==other.a && s==other.s;
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &inner::a),
+    PBSS_TAG_MEMBER(2, &inner::s));
+};
+
+struct pos {
+  float x, y;
+
+  bool operator==(const pos& other) const
+  {
+    return x==other.x && y==other.y;
+  }
+
+  PBSS_TUPLE_MEMBERS(
+    PBSS_TUPLE_MEMBER(&pos::x),
+    PBSS_TUPLE_MEMBER(&pos::y));
+};
+
+struct outer {
+  uint32_t id;
+  std::vector<inner> inners;
+  std::vector<pos> path;
+  std::map<std::string, pbss::var_uint<uint64_t>> counts;
+  std::tuple<int8_t, std::list<double>> extra;
+
+  bool operator==(const outer& other) const
+  {
+    return id==other.id && inners==other.inners && path==other.path &&
+      counts==other.counts && extra==other.extra;
+  }
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &outer::id),
+    PBSS_TAG_MEMBER(2, &outer::inners),
+    PBSS_TAG_MEMBER(3, &outer::path),
+    PBSS_TAG_MEMBER(4, &outer::counts),
+    PBSS_TAG_MEMBER(5, &outer::extra));
+};
+
+static pbss::buffer to_buffer(const std::string& str)
+{
+  pbss::buffer buf(str.size());
+  std::copy(str.begin(), str.end(), reinterpret_cast<char*>(buf.data()));
+  return buf;
+}
+
+template <class T>
+static bool validates(const std::string& str)
+{
+  return pbss::validate<T>(str.data(), str.data() + str.size());
+}
+
+int main()
+{
+  const outer value {
+    7,
+    {{1, "ab"}, {-2, ""}, {3, std::string(300, 'x')}},
+    {{0.5f, 1.5f}, {2, 3}},
+    {{"a", pbss::make_var_uint(uint64_t(1))},
+     {"b", pbss::make_var_uint(uint64_t(300))},
+     {"c", pbss::make_var_uint(uint64_t(1) << 60)}},
+    {4, {1.0, 2.0}}};
+  const auto str = pbss::serialize_to_string(value);
+
+  // well formed input parses the same
+  assert(validates<outer>(str));
+  assert(pbss::parse_from_buffer_validated<outer>(to_buffer(str)) == value);
+  assert(validates<outer>(str + "trailing"));
+
+  // any truncation is caught up front, and reported as parsing would
+  for (std::size_t n = 0; n < str.size(); ++n) {
+    auto prefix = str.substr(0, n);
+    assert(!validates<outer>(prefix));
+    try {
+      pbss::parse_from_buffer_validated<outer>(to_buffer(prefix));
+      assert(false);
+    } catch (pbss::early_eof_error&) {
+    }
+  }
+
+  // unknown members are only checked to be in range
+  {
+    std::string in {1, 4, 9, 0, 0, 0, 9, 2, 'x', 'y', 0};
+    assert(validates<outer>(in));
+    assert(pbss::parse_from_buffer_validated<outer>(to_buffer(in)).id == 9);
+    assert(!validates<outer>({1, 4, 9, 0, 0, 0, 9, 3, 'x', 'y', 0}));
+  }
+
+  // stored lengths disagreeing with the member are rejected, though the
+  // checked parser may go on anyway
+  {
+    std::string in {1, 2, 5, 0, 2, 2, 3, 'c', 'd', 'e', 0};
+    assert(pbss::parse_from_string<inner>(in) == (inner{5, "cde"}));
+    assert(!validates<inner>(in));
+    assert(pbss::parse_from_buffer_validated<inner>(to_buffer(in)) == (inner{5, "cde"}));
+    assert(validates<inner>({1, 2, 5, 0, 2, 4, 3, 'c', 'd', 'e', 0}));
+  }
+  // so are lengths of fixed size members in more chars than usual
+  assert(!validates<inner>({1, char(0x82), 0, 5, 0, 0}));
+
+  // lengths must fit
+  assert(!validates<std::string>({char(0xff), char(0xff), char(0xff), char(0xff), char(0xff),
+                                  char(0xff), char(0xff), char(0xff), char(0xff), 0x7f}));
+  assert(!validates<std::vector<std::string>>({char(0xff), char(0xff), 0x7f, 0}));
+  // and arrays are not overrun
+  assert((validates<std::array<int16_t, 2>>({2, 1, 0, 2, 0})));
+  assert((!validates<std::array<int16_t, 2>>({3, 1, 0, 2, 0, 3, 0})));
+
+  // var uints need only end in range
+  assert(validates<pbss::var_uint<uint8_t>>({char(0x80), 1}));
+  assert(!validates<pbss::var_uint<uint8_t>>({char(0x80)}));
+
+  // the reader itself
+  {
+    std::string in {2, 3};
+    pbss::unchecked_char_range_reader reader(in.data(), in.data() + in.size());
+    assert(!reader.eof());
+    assert(reader.lookahead(2) && !reader.lookahead(3));
+    assert(reader.get() == 2);
+    assert(reader.peek() == 3);
+    reader.ignore(1);
+    assert(reader.peek() == std::char_traits<char>::eof());
+  }
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include "checker.hh"
+
+using pbss::var_uint;
+
+// reference encoding, a byte at a time
+static std::string encode(uint64_t n)
+{
+  std::string str;
+  do {
+    str.push_back(char((n&0x7f) | (n>0x7f ? 0x80 : 0)));
+  } while (n>>=7);
+  return str;
+}
+
+template <class UInt>
+static void check_sequence(const std::vector<var_uint<UInt>>& values)
+{
+  std::string expected = encode(values.size());
+  for (auto v : values)
+    expected += encode(v.v);
+  check_serialize(values, expected);
+  check_parse(expected, values);
+  // bulk decoding stops short of the end, with trailing input or not
+  check_parse(expected + std::string(8, '\xff'), values);
+  if (!values.empty())
+    check_early_eof<std::vector<var_uint<UInt>>>(expected.substr(0, expected.size()-1));
+}
+
+int main()
+{
+  // boundaries of each length, up to 10 bytes
+  std::vector<var_uint<uint64_t>> boundaries;
+  for (unsigned bits = 0; bits <= 63; bits += 7) {
+    boundaries.push_back({(uint64_t(1)<<bits)});
+    boundaries.push_back({(uint64_t(1)<<bits)-1});
+  }
+  boundaries.push_back({0xffffffffffffffff});
+  check_sequence(boundaries);
+
+  // each value decoded within a word, with the word extending past it
+  for (auto v : boundaries)
+    check_parse(encode(v.v) + std::string(8, '\x80'), v);
+
+  // runs of single byte values, and a run broken by a longer one
+  {
+    std::vector<var_uint<uint32_t>> small;
+    for (uint32_t i = 0; i != 100; ++i)
+      small.push_back({i});
+    check_sequence(small);
+    small[42].v = 300;
+    check_sequence(small);
+  }
+
+  // mixed lengths, longer than a chunk of the encoder
+  {
+    std::vector<var_uint<uint64_t>> mixed;
+    uint64_t x = 1;
+    for (int i = 0; i != 1000; ++i) {
+      x = x * 6364136223846793005ull + 1442695040888963407ull;
+      mixed.push_back({x >> (x & 63)});
+    }
+    check_sequence(mixed);
+  }
+
+  // narrower element types
+  check_sequence(std::vector<var_uint<uint8_t>>{{0}, {0x7f}, {0x80}, {0xff}});
+  check_sequence(std::vector<var_uint<uint16_t>>{{0x3fff}, {0x4000}, {0xffff}});
+
+  check_sequence(std::vector<var_uint<uint64_t>>{});
+
+  return 0;
+}
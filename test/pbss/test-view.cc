@@ -0,0 +1,241 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include "checker.hh"
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <bs3/pbss/view.hh>
+
+struct hit {
+  int32_t time;
+  double area;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &hit::time),
+    PBSS_TAG_MEMBER(2, &hit::area));
+};
+
+struct channel {
+  uint32_t id;
+  std::vector<hit> hits;
+  std::string name;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &channel::id),
+    PBSS_TAG_MEMBER(3, &channel::hits),
+    PBSS_TAG_MEMBER(2, &channel::name));
+};
+
+struct event {
+  uint32_t run;
+  uint32_t number = 7;
+  std::vector<channel> channels;
+  std::map<int, std::string> notes;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &event::run),
+    PBSS_TAG_MEMBER(2, &event::number),
+    PBSS_TAG_MEMBER(3, &event::channels),
+    PBSS_TAG_MEMBER(4, &event::notes));
+};
+
+struct reordered_event {
+  uint32_t run;
+  uint32_t number;
+  std::string extra;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(9, &reordered_event::extra),
+    PBSS_TAG_MEMBER(2, &reordered_event::number),
+    PBSS_TAG_MEMBER(1, &reordered_event::run));
+};
+
+struct hit_time_only {
+  uint32_t time;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &hit_time_only::time));
+};
+
+// two versions of a struct of fixed size
+struct sample_v1 {
+  int32_t a;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &sample_v1::a));
+};
+
+struct sample_v2 {
+  int32_t a;
+  int32_t b;
+
+  PBSS_TAGGED_STRUCT(
+    PBSS_TAG_MEMBER(1, &sample_v2::a),
+    PBSS_TAG_MEMBER(2, &sample_v2::b));
+};
+
+struct point {
+  int16_t x;
+  std::string label;
+
+  PBSS_TUPLE_MEMBERS(
+    PBSS_TUPLE_MEMBER(&point::x),
+    PBSS_TUPLE_MEMBER(&point::label));
+};
+
+int main()
+{
+
+  event ev { 42, 6, {
+      { 1, { {10, 1.5}, {20, 2.5} }, "a" },
+      { 2, {}, "bb" },
+      { 3, { {30, 3.5} }, "ccc" } },
+    { {1, "x"}, {2, "y"} } };
+  auto buf = pbss::serialize_to_buffer(ev);
+  auto v = pbss::make_view<event>(buf);
+
+  {
+    // members of tagged structs
+    assert(v.get<&event::run>() == 42);
+    assert(v.get<&event::number>() == 6);
+    assert(v.has<&event::channels>());
+  }
+
+  {
+    // views follow tags, not declaration order; absent members are
+    // default
+    auto other = pbss::serialize_to_buffer(reordered_event {5, 6, "x"});
+    auto ov = pbss::make_view<event>(other);
+    assert(ov.get<&event::run>() == 5);
+    assert(ov.get<&event::number>() == 6);
+    assert(!ov.has<&event::channels>());
+    assert(ov.get<&event::channels>().empty());
+
+    auto sparse = pbss::serialize_to_buffer(hit_time_only {3});
+    auto sv = pbss::make_view<event>(sparse);
+    assert(sv.get<&event::run>() == 3);
+    assert(!sv.has<&event::number>());
+    assert(sv.get<&event::number>() == 7);
+    try {
+      sv.at<&event::number>();
+      assert("Expected missing_field_error but it did not throw" && false);
+    } catch (const pbss::missing_field_error&) {
+      // good
+    }
+  }
+
+  {
+    // nested sequences are iterated lazily
+    auto channels = v.at<&event::channels>();
+    assert(channels.size() == 3);
+    std::vector<uint32_t> ids;
+    std::vector<std::string> names;
+    for (auto ch : channels) {
+      ids.push_back(ch.get<&channel::id>());
+      names.push_back(ch.get<&channel::name>());
+    }
+    assert((ids == std::vector<uint32_t> {1, 2, 3}));
+    assert((names == std::vector<std::string> {"a", "bb", "ccc"}));
+
+    // indexing
+    auto hits = channels[2].at<&channel::hits>();
+    assert(hits.size() == 1);
+    assert(hits[0].get<&hit::area>() == 3.5);
+    assert((channels[0].at<&channel::hits>()[1].get<&hit::time>() == 20));
+    assert(channels[1].at<&channel::hits>().empty());
+    assert(channels[1].at<&channel::hits>().begin() == channels[1].at<&channel::hits>().end());
+
+    // parse a whole subtree, or as a borrowed view
+    auto first = channels[0].get();
+    assert(first.id == 1 && first.hits.size() == 2 && first.name == "a");
+    assert((channels[2].get<&channel::name, std::string_view>() == "ccc"));
+    assert(channels[2].at<&channel::name>().get<std::string_view>() == "ccc");
+  }
+
+  {
+    // associative containers are sequences of pairs
+    std::vector<std::pair<int, std::string>> notes;
+    for (auto note : v.at<&event::notes>())
+      notes.push_back(note.get());
+    assert((notes == std::vector<std::pair<int, std::string>> {{1, "x"}, {2, "y"}}));
+  }
+
+  {
+    // skip moves past a whole value
+    auto str = pbss::serialize_to_string(ev) + "pad";
+    pbss::char_range_reader reader(str.data(), str.data() + str.size());
+    pbss::skip<event>(reader);
+    assert(reader.borrow(3) == str.data() + str.size() - 3);
+
+    std::vector<point> points { {1, "a"}, {2, "bc"} };
+    auto pstr = pbss::serialize_to_string(std::make_pair(points, ev)) + "pad";
+    std::istringstream in(pstr);
+    pbss::skip<std::pair<std::vector<point>, event>>(in);
+    assert(in.rdbuf()->in_avail() == 3);
+  }
+
+  {
+    // tagged structs of fixed size are skipped and indexed by their tags,
+    // so data written by another version of the struct reads fine
+    std::vector<sample_v1> old { {1}, {2}, {3} };
+    auto str = pbss::serialize_to_string(old);
+    pbss::char_range_reader reader(str.data(), str.data() + str.size());
+    pbss::skip<std::vector<sample_v2>>(reader);
+    assert(!reader.eof() && reader.borrow(0) == str.data() + str.size());
+
+    auto old_buf = pbss::serialize_to_buffer(old);
+    auto ov = pbss::make_view<std::vector<sample_v2>>(old_buf);
+    assert(ov[1].get<&sample_v2::a>() == 2);
+    assert(!ov[2].has<&sample_v2::b>());
+  }
+
+  {
+    // sequences too long for any input to hold
+    auto str = pbss::serialize_to_string(pbss::make_var_uint((std::size_t(1) << 62) + 1));
+    pbss::char_range_reader reader(str.data(), str.data() + str.size());
+    try {
+      pbss::skip<std::vector<int32_t>>(reader);
+      assert("Expected early_eof_error but it did not throw" && false);
+    } catch (const pbss::early_eof_error&) {
+      // good
+    }
+  }
+
+  {
+    // early eof while looking for a member
+    auto truncated = pbss::buffer(buf.begin(), buf.begin() + 8);
+    try {
+      pbss::make_view<event>(truncated).get<&event::notes>();
+      assert("Expected early_eof_error but it did not throw" && false);
+    } catch (const pbss::early_eof_error&) {
+      // good
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,64 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+#include <cassert>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <bs3/utils/parallel.hh>
+
+int main()
+{
+
+  assert(pbsu::default_concurrency() >= 1);
+
+  {
+    // every index runs once
+    std::vector<int> runs(8);
+    pbsu::run_parallel(8, [&](unsigned i) { ++runs[i]; });
+    assert(runs == std::vector<int>(8, 1));
+    // nothing to run
+    pbsu::run_parallel(0, [&](unsigned) { assert(false); });
+  }
+
+  {
+    // the exception from the lowest index is rethrown, after all are done
+    std::atomic<int> done {0};
+    try {
+      pbsu::run_parallel(4, [&](unsigned i) {
+          ++done;
+          if (i == 1)
+            throw std::out_of_range("1");
+          if (i == 3)
+            throw std::runtime_error("3");
+        });
+      assert("exception not rethrown" && false);
+    } catch (std::out_of_range&) {
+      // pass
+    }
+    assert(done == 4);
+  }
+
+  return 0;
+}
@@ -0,0 +1,100 @@
+/*
+
+    Copyright 2016 Carl Lei
+
+    This file is part of Bamboo Shoot 3.
+
+    Bamboo Shoot 3 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Bamboo Shoot 3 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Bamboo Shoot 3.  If not, see <http://www.gnu.org/licenses/>.
+
+    Carl Lei <xecycle@gmail.com>
+
+*/
+
+// bs3-verify: check every block of pbsf files before trusting them, e.g.
+// before archiving.  Exits with 0 if all are good, 1 if any is corrupt, 2
+// if any cannot be read.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include <bs3/pbsf/verify.hh>
+
+namespace {
+
+void usage(const char* argv0)
+{
+  std::cerr << "Usage: " << argv0 << " [-d] [-j threads] [-q] file...\n"
+            << "  -d          also check that blocks decode\n"
+            << "  -j threads  threads to use, default one per core\n"
+            << "  -q          print only problems\n";
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+  pbsf::verify_options options;
+  bool quiet = false;
+  for (int opt; (opt = getopt(argc, argv, "dj:q")) != -1; ) {
+    switch (opt) {
+    case 'd':
+      options.decode = true;
+      break;
+    case 'j':
+      options.threads = static_cast<unsigned>(std::strtoul(optarg, nullptr, 10));
+      break;
+    case 'q':
+      quiet = true;
+      break;
+    default:
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (optind == argc) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  int status = 0;
+  for (int i = optind; i != argc; ++i) {
+    std::string filename(argv[i]);
+    try {
+      auto start = std::chrono::steady_clock::now();
+      auto result = pbsf::verify_file(filename, options);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      for (auto& e : result.errors)
+        std::cout << filename << ": offset " << e.offset
+                  << ", type " << e.contentType << ": " << e.what << '\n';
+      if (!result.ok())
+        status = std::max(status, 1);
+      if (!quiet)
+        std::cout << filename << ": realm " << result.realm << ", "
+                  << result.blocks << " blocks, " << result.bytes << " bytes, "
+                  << (result.ok() ? "ok" : "CORRUPT") << " ("
+                  << double(result.bytes) / 1e6 / elapsed.count() << " MB/s)\n";
+    } catch (const std::exception& e) {
+      std::cerr << filename << ": " << e.what() << '\n';
+      status = 2;
+    }
+  }
+  return status;
+}